@@ -22,9 +22,11 @@
 #include "part.h"
 #include "ball.h"
 #include "image.h"
+#include "image_async.h"
 #include "audio.h"
 #include "config.h"
 #include "video.h"
+#include "log.h"
 
 #include "solid_draw.h"
 
@@ -345,7 +347,11 @@ void game_client_sync(fs_file demo_fp)
 int  game_client_init(const char *file_name)
 {
     char *back_name = "", *grad_name = "";
-    int i;
+    int i, n;
+
+    struct image_count c0 = image_total;
+    struct mtrl_count  m0 = mtrl_total;
+    Uint32 t0 = SDL_GetTicks();
 
     coins  = 0;
     status = GAME_NONE;
@@ -436,6 +442,34 @@ int  game_client_init(const char *file_name)
 
     light_reset();
 
+    /*
+     * Report load time and how many textures came from the cache.  Those
+     * still streaming are counted when the stream drains.
+     */
+
+    n = image_async_count();
+
+    log_printf("Loaded %s in %d ms (%d textures cached, %d decoded, %d ms, "
+               "%d streaming)\n",
+               file_name, (int) (SDL_GetTicks() - t0),
+               image_total.hits   - c0.hits,
+               image_total.misses - c0.misses,
+               image_total.ms     - c0.ms, n);
+
+    if (n)
+        log_printf("Textures: %d kept, %d loaded, %d released, "
+                   "still loading\n",
+                   mtrl_total.hits   - m0.hits,
+                   mtrl_total.loads  - m0.loads,
+                   mtrl_total.evicts - m0.evicts);
+    else
+        log_printf("Textures: %d kept, %d loaded, %d released, "
+                   "%d KB resident\n",
+                   mtrl_total.hits   - m0.hits,
+                   mtrl_total.loads  - m0.loads,
+                   mtrl_total.evicts - m0.evicts,
+                   mtrl_resident() / 1024);
+
     return gd.state;
 }
 
@@ -57,28 +57,9 @@ static void game_draw_items(struct s_rend *rend,
                             const struct s_vary *vary,
                             const float *bill_M, float t)
 {
-    int hi;
+    /* Draw the models of all items not yet picked up, batched by kind. */
 
-    for (hi = 0; hi < vary->hc; hi++)
-    {
-        struct v_item *hp = &vary->hv[hi];
-
-        /* Skip picked up items. */
-
-        if (hp->t == ITEM_NONE)
-            continue;
-
-        /* Draw model. */
-
-        glPushMatrix();
-        {
-            glTranslatef(hp->p[0],
-                         hp->p[1],
-                         hp->p[2]);
-            item_draw(rend, hp, bill_M, t);
-        }
-        glPopMatrix();
-    }
+    item_draw_all(rend, vary->hv, vary->hc, bill_M, t);
 }
 
 static void game_draw_beams(struct s_rend *rend, const struct game_draw *gd)
@@ -168,6 +149,40 @@ static void game_refl_all(struct s_rend *rend, const struct game_draw *gd)
     glPopMatrix();
 }
 
+static int game_refl_view(const struct game_draw *gd, float *r)
+{
+    int n;
+
+    /* Find the screen area covered by the mirrors, if any. */
+
+    glPushMatrix();
+    {
+        game_draw_tilt(gd, 1);
+
+        n = sol_refl_bound(&gd->draw, r);
+    }
+    glPopMatrix();
+
+    return n;
+}
+
+static void game_refl_scissor(const float *r)
+{
+    GLint v[4];
+    GLint x0, y0, x1, y1;
+
+    /* Confine the mirrored pass to the mirrors' screen rectangle. */
+
+    glGetIntegerv(GL_VIEWPORT, v);
+
+    x0 = v[0] + (GLint) floorf((r[0] + 1.0f) * 0.5f * v[2]);
+    y0 = v[1] + (GLint) floorf((r[1] + 1.0f) * 0.5f * v[3]);
+    x1 = v[0] + (GLint) ceilf ((r[2] + 1.0f) * 0.5f * v[2]);
+    y1 = v[1] + (GLint) ceilf ((r[3] + 1.0f) * 0.5f * v[3]);
+
+    glScissor(x0, y0, x1 - x0, y1 - y0);
+}
+
 /*---------------------------------------------------------------------------*/
 
 static void game_draw_light(const struct game_draw *gd, int d, float t)
@@ -420,7 +435,7 @@ void game_draw(struct game_draw *gd, int pose, float t)
         video_push_persp(fov, 0.1f, FAR_DIST);
         glPushMatrix();
         {
-            float T[16], U[16], M[16], v[3];
+            float T[16], U[16], M[16], v[3], r[4];
 
             /* Compute direct and reflected view bases. */
 
@@ -445,10 +460,14 @@ void game_draw(struct game_draw *gd, int pose, float t)
 
             game_draw_back(&rend, gd, pose, +1, t);
 
-            /* Draw the reflection. */
+            /* Draw the reflection, if any mirror is in view. */
 
-            if (gd->draw.reflective && config_get_d(CONFIG_REFLECTION))
+            if (gd->draw.reflective && config_get_d(CONFIG_REFLECTION) &&
+                game_refl_view(gd, r))
             {
+                game_refl_scissor(r);
+
+                glEnable(GL_SCISSOR_TEST);
                 glEnable(GL_STENCIL_TEST);
                 {
                     /* Draw the mirrors only into the stencil buffer. */
@@ -466,6 +485,9 @@ void game_draw(struct game_draw *gd, int pose, float t)
                     glStencilFunc(GL_EQUAL, 1, 0xFFFFFFFF);
 
                     /* Draw the scene reflected into color and depth buffers. */
+                    /* Only bodies seen through the mirrors need drawing.    */
+
+                    r_clip_rect(&rend, r);
 
                     glFrontFace(GL_CW);
                     glPushMatrix();
@@ -480,9 +502,12 @@ void game_draw(struct game_draw *gd, int pose, float t)
                     glPopMatrix();
                     glFrontFace(GL_CCW);
 
+                    r_clip_rect(&rend, NULL);
+
                     glStencilFunc(GL_ALWAYS, 0, 0xFFFFFFFF);
                 }
                 glDisable(GL_STENCIL_TEST);
+                glDisable(GL_SCISSOR_TEST);
             }
 
             /* Ready the lights for foreground rendering. */
@@ -26,6 +26,7 @@
 
 #include "game_common.h"
 #include "game_client.h"
+#include "common.h"
 
 /*---------------------------------------------------------------------------*/
 
@@ -40,6 +41,10 @@ static int goal_id;
 static int cam_id;
 static int fps_id;
 
+#if ENABLE_GLSTAT
+static int glstat_id;
+#endif
+
 static int speed_id;
 static int speed_ids[SPEED_MAX];
 
@@ -53,6 +58,20 @@ static float speed_timer;
 static void hud_fps(void)
 {
     gui_set_count(fps_id, video_perf());
+
+#if ENABLE_GLSTAT
+    {
+        static char last[MAXSTR];
+
+        /* Rebuild the label texture only when the stats roll over. */
+
+        if (strcmp(last, glstat_text()) != 0)
+        {
+            SAFECPY(last, glstat_text());
+            gui_set_label(glstat_id, last);
+        }
+    }
+#endif
 }
 
 void hud_init(void)
@@ -117,6 +136,15 @@ void hud_init(void)
         gui_layout(fps_id, -1, 1);
     }
 
+#if ENABLE_GLSTAT
+    if ((glstat_id = gui_label(0, GLSTAT_TEXT_MAX, GUI_SML, gui_wht, gui_wht)))
+    {
+        gui_set_label(glstat_id, glstat_text());
+        gui_set_rect(glstat_id, GUI_BOT);
+        gui_layout(glstat_id, 0, +1);
+    }
+#endif
+
     if ((speed_id = gui_varray(0)))
     {
         int i;
@@ -139,6 +167,10 @@ void hud_free(void)
     gui_delete(cam_id);
     gui_delete(fps_id);
 
+#if ENABLE_GLSTAT
+    gui_delete(glstat_id);
+#endif
+
     gui_delete(speed_id);
 
     for (i = SPEED_NONE + 1; i < SPEED_MAX; i++)
@@ -154,7 +186,12 @@ void hud_paint(void)
     gui_paint(time_id);
 
     if (config_get_d(CONFIG_FPS))
+    {
         gui_paint(fps_id);
+#if ENABLE_GLSTAT
+        gui_paint(glstat_id);
+#endif
+    }
 
     hud_cam_paint();
     hud_speed_paint();
@@ -23,6 +23,7 @@
 #include "config.h"
 #include "video.h"
 #include "image.h"
+#include "image_async.h"
 #include "audio.h"
 #include "demo.h"
 #include "progress.h"
@@ -35,6 +36,7 @@
 #include "text.h"
 #include "mtrl.h"
 #include "geom.h"
+#include "solid_draw.h"
 
 #include "st_conf.h"
 #include "st_title.h"
@@ -319,6 +321,7 @@ static int loop(void)
 static char *opt_data;
 static char *opt_replay;
 static char *opt_level;
+static int   opt_headless;
 
 #define opt_usage                                                     \
     "Usage: %s [options ...]\n"                                       \
@@ -327,7 +330,8 @@ static char *opt_level;
     "  -v, --version             show version.\n"                     \
     "  -d, --data <dir>          use 'dir' as game data directory.\n" \
     "  -r, --replay <file>       play the replay 'file'.\n"           \
-    "  -l, --level <file>        load the level 'file'\n"
+    "  -l, --level <file>        load the level 'file'\n"             \
+    "      --headless-render <n> render n frames offscreen as CSV.\n"
 
 #define opt_error(option) \
     fprintf(stderr, "Option '%s' requires an argument.\n", option)
@@ -385,6 +389,22 @@ static void opt_parse(int argc, char **argv)
             continue;
         }
 
+        if (strcmp(argv[i], "--headless-render") == 0)
+        {
+            if (i + 1 == argc)
+            {
+                opt_error(argv[i]);
+                exit(EXIT_FAILURE);
+            }
+#if ENABLE_HEADLESS
+            opt_headless = MAX(atoi(argv[++i]), 1);
+            continue;
+#else
+            fprintf(stderr, "Headless rendering is not built in.\n");
+            exit(EXIT_FAILURE);
+#endif
+        }
+
         /* Perform magic on a single unrecognized argument. */
 
         if (argc == 2)
@@ -476,6 +496,61 @@ static void make_dirs_and_migrate(void)
 
 /*---------------------------------------------------------------------------*/
 
+#if ENABLE_HEADLESS
+
+#define HEADLESS_W 800
+#define HEADLESS_H 600
+
+/*
+ * Step and render a fixed number of frames offscreen at a fixed rate and
+ * resolution, printing the CPU time spent submitting each and the render
+ * counters it accumulated.
+ */
+
+static void headless_render(int n)
+{
+    const float dt = 1.0f / 60.0f;
+    const double f = (double) SDL_GetPerformanceFrequency();
+
+    int i;
+
+    printf("frame,submit_ms,draw_calls,tris,"
+           "mtrl_binds,tex_binds,drawn,culled\n");
+
+    for (i = 0; i < n; i++)
+    {
+        Uint64 t0, t1;
+
+        st_timer(dt);
+
+        /* Render every frame with its textures fully loaded. */
+
+        image_async_wait();
+
+        memset(&r_total, 0, sizeof (r_total));
+
+        t0 = SDL_GetPerformanceCounter();
+        st_paint(dt * (i + 1));
+        t1 = SDL_GetPerformanceCounter();
+
+        /* Wait for the frame, keeping it out of the next one's time. */
+
+        video_swap();
+
+        printf("%d,%.3f,%d,%d,%d,%d,%d,%d\n", i, 1000.0 * (t1 - t0) / f,
+               r_total.draw_calls,
+               r_total.tris,
+               r_total.mtrl_binds,
+               r_total.tex_binds,
+               r_total.drawn,
+               r_total.culled);
+    }
+}
+
+#endif
+
+/*---------------------------------------------------------------------------*/
+
 int main(int argc, char *argv[])
 {
     SDL_Joystick *joy = NULL;
@@ -494,6 +569,14 @@ int main(int argc, char *argv[])
     log_init("Neverball", "neverball.log");
     make_dirs_and_migrate();
 
+    /* Keep SDL away from the display and sound card when headless. */
+
+    if (opt_headless)
+    {
+        set_env_var("SDL_VIDEODRIVER", "dummy");
+        set_env_var("SDL_AUDIODRIVER", "dummy");
+    }
+
     /* Initialize SDL. */
 
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK) == -1)
@@ -527,6 +610,14 @@ int main(int argc, char *argv[])
 
     /* Initialize video. */
 
+#if ENABLE_HEADLESS
+    if (opt_headless)
+    {
+        if (!video_init_headless(HEADLESS_W, HEADLESS_H))
+            return 1;
+    }
+    else
+#endif
     if (!video_init())
         return 1;
 
@@ -578,6 +669,16 @@ int main(int argc, char *argv[])
 
     /* Run the main game loop. */
 
+#if ENABLE_HEADLESS
+    if (opt_headless)
+    {
+        headless_render(opt_headless);
+        video_quit_headless();
+        SDL_Quit();
+        return 0;
+    }
+#endif
+
     t0 = SDL_GetTicks();
 
     while (loop())
@@ -590,6 +691,10 @@ int main(int argc, char *argv[])
 
             t0 = t1;
 
+            /* Upload textures loaded in the background. */
+
+            image_async_step(config_get_d(CONFIG_UPLOAD_BUDGET));
+
             /* Render. */
 
             hmd_step();
@@ -120,7 +120,7 @@ static int gui_demo_thumbs(int id)
                         {
                             gui_space(ld);
 
-                            thumb->shot = gui_image(ld, " ", w / 6, h / 6);
+                            thumb->shot = gui_thumb(ld, "", w / 6, h / 6);
                             thumb->name = gui_label(ld, " ", GUI_SML,
                                                     gui_wht, gui_wht);
 
@@ -152,7 +152,7 @@ static void gui_demo_update_thumbs(void)
         item = DIR_ITEM_GET(items, thumbs[i].item);
         demo = item->data;
 
-        gui_set_image(thumbs[i].shot, demo ? demo->shot : "");
+        gui_set_thumb(thumbs[i].shot, demo ? demo->shot : "");
         gui_set_label(thumbs[i].name, demo ? demo->name : base_name(item->path));
     }
 }
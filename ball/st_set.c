@@ -114,7 +114,7 @@ static int set_gui(void)
 
         if ((jd = gui_harray(id)))
         {
-            shot_id = gui_image(jd, set_shot(first), 7 * w / 16, 7 * h / 16);
+            shot_id = gui_thumb(jd, set_shot(first), 7 * w / 16, 7 * h / 16);
 
             if ((kd = gui_varray(jd)))
             {
@@ -149,7 +149,7 @@ static int set_enter(struct state *st, struct state *prev)
 
 static void set_over(int i)
 {
-    gui_set_image(shot_id, set_shot(i));
+    gui_set_thumb(shot_id, set_shot(i));
     gui_set_multi(desc_id, set_desc(i));
 }
 
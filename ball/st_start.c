@@ -78,7 +78,7 @@ static void start_over_level(int i)
 
     if (level_opened(l) || config_cheat())
     {
-        gui_set_image(shot_id, level_shot(l));
+        gui_set_thumb(shot_id, level_shot(l));
 
         set_score_board(level_score(l, SCORE_COIN), -1,
                         level_score(l, SCORE_TIME), -1,
@@ -102,7 +102,7 @@ static void start_over(int id, int pulse)
         }
         else
         {
-            gui_set_image(shot_id, set_shot(curr_set()));
+            gui_set_thumb(shot_id, set_shot(curr_set()));
 
             set_score_board(set_score(curr_set(), SCORE_COIN), -1,
                             set_score(curr_set(), SCORE_TIME), -1,
@@ -182,14 +182,14 @@ static int start_gui(void)
             {
                 if ((kd = gui_vstack(jd)))
                 {
-                    shot_id = gui_image(kd, set_shot(curr_set()),
+                    shot_id = gui_thumb(kd, set_shot(curr_set()),
                                         6 * w / 16, 6 * h / 16);
                     file_id = gui_label(kd, " ", GUI_SML, gui_yel, gui_red);
                 }
             }
             else
             {
-                shot_id = gui_image(jd, set_shot(curr_set()),
+                shot_id = gui_thumb(jd, set_shot(curr_set()),
                                     7 * w / 16, 7 * h / 16);
             }
 
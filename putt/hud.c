@@ -13,12 +13,14 @@
  */
 
 #include <math.h>
+#include <string.h>
 
 #include "gui.h"
 #include "hud.h"
 #include "hole.h"
 #include "config.h"
 #include "video.h"
+#include "common.h"
 
 /*---------------------------------------------------------------------------*/
 
@@ -26,6 +28,10 @@ static int Lhud_id;
 static int Rhud_id;
 static int fps_id;
 
+#if ENABLE_GLSTAT
+static int glstat_id;
+#endif
+
 /*---------------------------------------------------------------------------*/
 
 void hud_init(void)
@@ -58,6 +64,15 @@ void hud_init(void)
         gui_set_rect(fps_id, GUI_SE);
         gui_layout(fps_id, -1, +1);
     }
+
+#if ENABLE_GLSTAT
+    if ((glstat_id = gui_label(0, GLSTAT_TEXT_MAX, GUI_SML, gui_wht, gui_wht)))
+    {
+        gui_set_label(glstat_id, glstat_text());
+        gui_set_rect(glstat_id, GUI_BOT);
+        gui_layout(glstat_id, 0, +1);
+    }
+#endif
 }
 
 void hud_free(void)
@@ -65,6 +80,10 @@ void hud_free(void)
     gui_delete(Lhud_id);
     gui_delete(Rhud_id);
     gui_delete(fps_id);
+
+#if ENABLE_GLSTAT
+    gui_delete(glstat_id);
+#endif
 }
 
 /*---------------------------------------------------------------------------*/
@@ -75,6 +94,19 @@ void hud_paint(void)
     {
         gui_set_count(fps_id, video_perf());
         gui_paint(fps_id);
+
+#if ENABLE_GLSTAT
+        {
+            static char last[MAXSTR];
+
+            if (strcmp(last, glstat_text()) != 0)
+            {
+                SAFECPY(last, glstat_text());
+                gui_set_label(glstat_id, last);
+            }
+            gui_paint(glstat_id);
+        }
+#endif
     }
 
     gui_paint(Rhud_id);
@@ -25,6 +25,7 @@
 #include "glext.h"
 #include "audio.h"
 #include "image.h"
+#include "image_async.h"
 #include "state.h"
 #include "config.h"
 #include "video.h"
@@ -369,6 +370,7 @@ int main(int argc, char *argv[])
                 if ((t1 = SDL_GetTicks()) > t0)
                 {
                     st_timer((t1 - t0) / 1000.f);
+                    image_async_step(config_get_d(CONFIG_UPLOAD_BUDGET));
                     hmd_step();
                     st_paint(0.001f * t1);
                     video_swap();
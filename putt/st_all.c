@@ -363,7 +363,7 @@ static int course_enter(struct state *st, struct state *prev)
 
         if ((jd = gui_hstack(id)))
         {
-            shot_id = gui_image(jd, course_shot(0), w / 3, h / 3);
+            shot_id = gui_thumb(jd, course_shot(0), w / 3, h / 3);
 
             gui_filler(jd);
 
@@ -379,7 +379,7 @@ static int course_enter(struct state *st, struct state *prev)
 
                             if (k < n)
                             {
-                                md = gui_image(ld, course_shot(k),
+                                md = gui_thumb(ld, course_shot(k),
                                                w / 3 / c, h / 3 / r);
                                 gui_set_state(md, k, 0);
 
@@ -438,7 +438,7 @@ static void course_point(int id, int x, int y, int dx, int dy)
 
         if (course_exists(i))
         {
-            gui_set_image(shot_id, course_shot(i));
+            gui_set_thumb(shot_id, course_shot(i));
             gui_set_multi(desc_id, _(course_desc(i)));
         }
         gui_pulse(jd, 1.2f);
@@ -455,7 +455,7 @@ static void course_stick(int id, int a, float v, int bump)
 
         if (course_exists(i))
         {
-            gui_set_image(shot_id, course_shot(i));
+            gui_set_thumb(shot_id, course_shot(i));
             gui_set_multi(desc_id, _(course_desc(i)));
         }
         gui_pulse(jd, 1.2f);
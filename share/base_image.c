@@ -18,6 +18,14 @@
 #include <string.h>
 #include <assert.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_NEON 1
+#endif
+
 #include "base_config.h"
 #include "base_image.h"
 
@@ -50,9 +58,215 @@ void image_near2(int *W, int *H, int w, int h)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Vector versions of the row kernels below, where the target has them.
+ * Each one handles the bulk of a row and leaves the remainder to the
+ * scalar loop that follows it, which is also the whole of the fallback.
+ */
+
+/*
+ * Accumulate N bytes of a source row into a row of 16-bit sums.
+ */
+static void row_add(unsigned short *t, const unsigned char *s, int n)
+{
+    int i = 0;
+
+#if IMAGE_SSE2
+    const __m128i z = _mm_setzero_si128();
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i a = _mm_loadu_si128((const __m128i *) (t + i));
+        __m128i c = _mm_loadu_si128((const __m128i *) (t + i + 8));
+
+        a = _mm_add_epi16(a, _mm_unpacklo_epi8(v, z));
+        c = _mm_add_epi16(c, _mm_unpackhi_epi8(v, z));
+
+        _mm_storeu_si128((__m128i *) (t + i),     a);
+        _mm_storeu_si128((__m128i *) (t + i + 8), c);
+    }
+#elif IMAGE_NEON
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(s + i);
+
+        vst1q_u16(t + i,     vaddw_u8(vld1q_u16(t + i),     vget_low_u8 (v)));
+        vst1q_u16(t + i + 8, vaddw_u8(vld1q_u16(t + i + 8), vget_high_u8(v)));
+    }
+#endif
+
+    for (; i < n; i++)
+        t[i] += s[i];
+}
+
+/*
+ * Average each N columns of a row of N-row sums into W pixels.
+ */
+static void row_scale(unsigned char *d, const unsigned short *t,
+                      int W, int b, int n)
+{
+    int j, i, k;
+
+    for (j = 0; j < W; j++)
+        for (i = 0; i < b; i++)
+        {
+            int c = 0;
+
+            for (k = 0; k < n; k++)
+                c += t[(j * n + k) * b + i];
+
+            d[j * b + i] = (unsigned char) (c / (n * n));
+        }
+}
+
+/*
+ * Average 2x2 blocks of the two given 4-byte-per-pixel source rows into
+ * N destination pixels, truncating as the general case does.
+ */
+static void row_half4(unsigned char *d, const unsigned char *s0,
+                                        const unsigned char *s1, int n)
+{
+    int j = 0, i;
+
+#if IMAGE_SSE2
+    const __m128i z = _mm_setzero_si128();
+
+    for (; j + 4 <= n; j += 4)
+    {
+        __m128i a0 = _mm_loadu_si128((const __m128i *) (s0 + j * 8));
+        __m128i a1 = _mm_loadu_si128((const __m128i *) (s0 + j * 8 + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *) (s1 + j * 8));
+        __m128i b1 = _mm_loadu_si128((const __m128i *) (s1 + j * 8 + 16));
+
+        /* Column sums, two source pixels per register. */
+
+        __m128i c0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, z),
+                                   _mm_unpacklo_epi8(b0, z));
+        __m128i c1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, z),
+                                   _mm_unpackhi_epi8(b0, z));
+        __m128i c2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, z),
+                                   _mm_unpacklo_epi8(b1, z));
+        __m128i c3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, z),
+                                   _mm_unpackhi_epi8(b1, z));
+
+        /* Pair each even pixel with its odd neighbour. */
+
+        __m128i e0 = _mm_add_epi16(_mm_unpacklo_epi64(c0, c1),
+                                   _mm_unpackhi_epi64(c0, c1));
+        __m128i e1 = _mm_add_epi16(_mm_unpacklo_epi64(c2, c3),
+                                   _mm_unpackhi_epi64(c2, c3));
+
+        _mm_storeu_si128((__m128i *) (d + j * 4),
+                         _mm_packus_epi16(_mm_srli_epi16(e0, 2),
+                                          _mm_srli_epi16(e1, 2)));
+    }
+#elif IMAGE_NEON
+    for (; j + 4 <= n; j += 4)
+    {
+        uint32x4x2_t a = vld2q_u32((const uint32_t *) (s0 + j * 8));
+        uint32x4x2_t b = vld2q_u32((const uint32_t *) (s1 + j * 8));
+
+        uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]);
+        uint8x16_t a1 = vreinterpretq_u8_u32(a.val[1]);
+        uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]);
+        uint8x16_t b1 = vreinterpretq_u8_u32(b.val[1]);
+
+        uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a0), vget_low_u8(a1)),
+                                  vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+        uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a0),
+                                           vget_high_u8(a1)),
+                                  vaddl_u8(vget_high_u8(b0),
+                                           vget_high_u8(b1)));
+
+        vst1q_u8(d + j * 4, vcombine_u8(vshrn_n_u16(lo, 2),
+                                        vshrn_n_u16(hi, 2)));
+    }
+#endif
+
+    for (; j < n; j++)
+        for (i = 0; i < 4; i++)
+            d[j * 4 + i] = (unsigned char) ((s0[j * 8 + i] +
+                                             s0[j * 8 + i + 4] +
+                                             s1[j * 8 + i] +
+                                             s1[j * 8 + i + 4]) / 4);
+}
+
+/*
+ * Copy N pixels of B bytes from S to D in reverse order.
+ */
+static void row_reverse(unsigned char *d, const unsigned char *s, int n, int b)
+{
+    int j = 0, i;
+
+#if IMAGE_SSE2
+    if (b == 4 || b == 2 || b == 1)
+    {
+        const int k = 16 / b;
+
+        for (; j + k <= n; j += k)
+        {
+            const unsigned char *e = s + (n - j - k) * b;
+
+            __m128i v = _mm_loadu_si128((const __m128i *) e);
+
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+
+            if (b < 4)
+            {
+                v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+                v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            }
+            if (b < 2)
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+            _mm_storeu_si128((__m128i *) (d + j * b), v);
+        }
+    }
+#elif IMAGE_NEON
+    if (b == 4 || b == 2 || b == 1)
+    {
+        const int k = 16 / b;
+
+        for (; j + k <= n; j += k)
+        {
+            uint8x16_t v = vld1q_u8(s + (n - j - k) * b);
+
+            if      (b == 4) v = vreinterpretq_u8_u32(vrev64q_u32(
+                                 vreinterpretq_u32_u8(v)));
+            else if (b == 2) v = vreinterpretq_u8_u16(vrev64q_u16(
+                                 vreinterpretq_u16_u8(v)));
+            else             v = vrev64q_u8(v);
+
+            vst1q_u8(d + j * b, vcombine_u8(vget_high_u8(v), vget_low_u8(v)));
+        }
+    }
+#endif
+
+    if (b == 3)
+        for (; j < n; j++)
+        {
+            d[j * 3 + 0] = s[(n - j - 1) * 3 + 0];
+            d[j * 3 + 1] = s[(n - j - 1) * 3 + 1];
+            d[j * 3 + 2] = s[(n - j - 1) * 3 + 2];
+        }
+
+    for (; j < n; j++)
+        for (i = 0; i < b; i++)
+            d[j * b + i] = s[(n - j - 1) * b + i];
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Each loader takes the factor K by which the caller means to shrink the
+ * image.  It decodes at as small a size as it cheaply can and leaves in K
+ * whatever factor remains to be applied.
+ */
+
 static void *image_load_png(const char *filename, int *width,
                                                   int *height,
-                                                  int *bytes)
+                                                  int *bytes, int *k)
 {
     fs_file fh;
 
@@ -76,7 +290,7 @@ static void *image_load_png(const char *filename, int *width,
 
     if (setjmp(png_jmpbuf(readp)) == 0)
     {
-        int w, h, b, i;
+        int w, h, b, i, n;
 
         /* Read the PNG header. */
 
@@ -104,25 +318,78 @@ static void *image_load_png(const char *filename, int *width,
         default: longjmp(png_jmpbuf(readp), -1);
         }
 
-        if (!(bytep = png_malloc(readp, h * sizeof (png_bytep))))
-            longjmp(png_jmpbuf(readp), -1);
+        /* Interlaced rows only come together at the last pass. */
+
+        n = *k;
 
-        /* Allocate the final pixel buffer and read pixels there. */
+        if (n < 1 || n > w || n > h ||
+            png_get_interlace_type(readp, infop) != PNG_INTERLACE_NONE)
+            n = 1;
 
-        if ((p = (unsigned char *) malloc(w * h * b)))
+        if (n > 1)
         {
-            for (i = 0; i < h; i++)
-                bytep[i] = p + w * b * (h - i - 1);
+            const int W = w / n;
+            const int H = h / n;
 
-            png_read_image(readp, bytep);
-            png_read_end(readp, NULL);
+            unsigned char  *r = (unsigned char  *) malloc(w * b);
+            unsigned short *t = (unsigned short *) malloc(W * n * b *
+                                                          sizeof (*t));
 
-            if (width)  *width  = w;
-            if (height) *height = h;
-            if (bytes)  *bytes  = b;
+            /*
+             * Sum each N rows as they are read and average them into
+             * the final pixel buffer.  Drop the first rows, as scaling
+             * the full image would.
+             */
+
+            if (r && t && (p = (unsigned char *) malloc(W * H * b)))
+            {
+                for (i = 0; i < h - H * n; i++)
+                    png_read_row(readp, r, NULL);
+
+                for (i = 0; i < H * n; i++)
+                {
+                    if (i % n == 0)
+                        memset(t, 0, W * n * b * sizeof (*t));
+
+                    png_read_row(readp, r, NULL);
+                    row_add(t, r, W * n * b);
+
+                    if (i % n == n - 1)
+                        row_scale(p + W * b * (H - i / n - 1), t, W, b, n);
+                }
+                png_read_end(readp, NULL);
+
+                if (width)  *width  = W;
+                if (height) *height = H;
+                if (bytes)  *bytes  = b;
+
+                *k /= n;
+            }
+            free(r);
+            free(t);
         }
+        else
+        {
+            if (!(bytep = png_malloc(readp, h * sizeof (png_bytep))))
+                longjmp(png_jmpbuf(readp), -1);
+
+            /* Allocate the final pixel buffer and read pixels there. */
+
+            if ((p = (unsigned char *) malloc(w * h * b)))
+            {
+                for (i = 0; i < h; i++)
+                    bytep[i] = p + w * b * (h - i - 1);
 
-        png_free(readp, bytep);
+                png_read_image(readp, bytep);
+                png_read_end(readp, NULL);
+
+                if (width)  *width  = w;
+                if (height) *height = h;
+                if (bytes)  *bytes  = b;
+            }
+
+            png_free(readp, bytep);
+        }
     }
     else p = NULL;
 
@@ -136,7 +403,7 @@ static void *image_load_png(const char *filename, int *width,
 
 static void *image_load_jpg(const char *filename, int *width,
                                                   int *height,
-                                                  int *bytes)
+                                                  int *bytes, int *k)
 {
     unsigned char *p = NULL;
     fs_file fp;
@@ -146,7 +413,7 @@ static void *image_load_jpg(const char *filename, int *width,
         struct jpeg_decompress_struct cinfo;
         struct jpeg_error_mgr         jerr;
 
-        int w, h, b, i = 0;
+        int w, h, b, i = 0, n = 1;
 
         /* Initialize the JPG decompressor. */
 
@@ -160,6 +427,15 @@ static void *image_load_jpg(const char *filename, int *width,
         /* Grab the JPG header info. */
 
         jpeg_read_header(&cinfo, TRUE);
+
+        /* Let the DCT do the first 1/2, 1/4 or 1/8 of any downscale. */
+
+        while (n < 8 && *k >= n * 2 && *k % (n * 2) == 0)
+            n *= 2;
+
+        cinfo.scale_num   = 1;
+        cinfo.scale_denom = n;
+
         jpeg_start_decompress(&cinfo);
 
         w = cinfo.output_width;
@@ -179,6 +455,8 @@ static void *image_load_jpg(const char *filename, int *width,
             if (width)  *width  = w;
             if (height) *height = h;
             if (bytes)  *bytes  = b;
+
+            *k /= n;
         }
 
         jpeg_finish_decompress(&cinfo);
@@ -190,20 +468,55 @@ static void *image_load_jpg(const char *filename, int *width,
     return p;
 }
 
-void *image_load(const char *filename, int *width,
-                                       int *height,
-                                       int *bytes)
+/*
+ * Load the named image reduced by a factor of K, as image_scale would.
+ */
+void *image_load_scaled(const char *filename, int *width,
+                                              int *height,
+                                              int *bytes, int k)
 {
+    void *p = NULL;
+    int   w = 0;
+    int   h = 0;
+    int   b = 0;
+
     if (filename)
     {
         const char *ext = filename + strlen(filename) - 4;
 
         if      (strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0)
-            return image_load_png(filename, width, height, bytes);
+            p = image_load_png(filename, &w, &h, &b, &k);
         else if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".JPG") == 0)
-            return image_load_jpg(filename, width, height, bytes);
+            p = image_load_jpg(filename, &w, &h, &b, &k);
     }
-    return NULL;
+
+    /* Finish any part of the downscale that decoding did not. */
+
+    if (p && k > 1 && k <= w && k <= h)
+    {
+        void *q;
+
+        if ((q = image_scale(p, w, h, b, &w, &h, k)))
+        {
+            free(p);
+            p = q;
+        }
+    }
+
+    if (p)
+    {
+        if (width)  *width  = w;
+        if (height) *height = h;
+        if (bytes)  *bytes  = b;
+    }
+    return p;
+}
+
+void *image_load(const char *filename, int *width,
+                                       int *height,
+                                       int *bytes)
+{
+    return image_load_scaled(filename, width, height, bytes, 1);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -222,19 +535,25 @@ void *image_next2(const void *p, int w, int h, int b, int *w2, int *h2)
 
     image_size(&W, &H, w, h);
 
-    if ((dst = (unsigned char *) calloc(W * H * b, sizeof (unsigned char))))
+    if ((dst = (unsigned char *) malloc(W * H * b)))
     {
         const int dr = (H - h) / 2;
         const int dc = (W - w) / 2;
 
         int r;
 
+        /* Clear only the border, since the rest is about to be copied. */
+
+        memset(dst, 0, dr * W * b);
+        memset(dst + (dr + h) * W * b, 0, (H - h - dr) * W * b);
+
         for (r = 0; r < h; ++r)
         {
-            const int R = r + dr;
-            const int C =     dc;
+            unsigned char *row = dst + (r + dr) * W * b;
 
-            memcpy(&dst[(R * W + C) * b], &src[(r * w) * b], w * b);
+            memset(row, 0, dc * b);
+            memcpy(row + dc * b, &src[(r * w) * b], w * b);
+            memset(row + (dc + w) * b, 0, (W - w - dc) * b);
         }
 
         if (w2) *w2 = W;
@@ -251,33 +570,88 @@ void *image_scale(const void *p, int w, int h, int b, int *wn, int *hn, int n)
 {
     unsigned char *src = (unsigned char *) p;
     unsigned char *dst = NULL;
+    unsigned short *t;
 
     int W = w / n;
     int H = h / n;
 
     if ((dst = (unsigned char *) calloc(W * H * b, sizeof (unsigned char))))
     {
-        int si, di;
-        int sj, dj;
+        int di, k;
+
+        if (n == 2 && b == 4)
+        {
+            /* Halving RGBA is the common case.  Take it in one pass. */
+
+            for (di = 0; di < H; di++)
+                row_half4(dst + di * W * b, src + (di * 2    ) * w * b,
+                                            src + (di * 2 + 1) * w * b, W);
+        }
+        else if ((t = (unsigned short *) malloc(W * n * b * sizeof (*t))))
+        {
+            /* Sum N source rows, then N columns of each sum. */
+
+            for (di = 0; di < H; di++)
+            {
+                memset(t, 0, W * n * b * sizeof (*t));
+
+                for (k = 0; k < n; k++)
+                    row_add(t, src + (di * n + k) * w * b, W * n * b);
+
+                row_scale(dst + di * W * b, t, W, b, n);
+            }
+            free(t);
+        }
+        else
+        {
+            free(dst);
+            return NULL;
+        }
+
+        if (wn) *wn = W;
+        if (hn) *hn = H;
+    }
+
+    return dst;
+}
+
+/*
+ * Allocate and return the next level of a mipmap chain, halving each
+ * dimension down to one.
+ */
+void *image_mip(const void *p, int w, int h, int b, int *wn, int *hn)
+{
+    unsigned char *src = (unsigned char *) p;
+    unsigned char *dst = NULL;
+
+    int W = (w > 1) ? w / 2 : 1;
+    int H = (h > 1) ? h / 2 : 1;
+
+    if ((dst = (unsigned char *) malloc(W * H * b)))
+    {
+        int di, dj;
         int i;
 
-        /* Iterate each component of each destination pixel. */
+        /* Average each 2x2 block, clamping at an edge of size one. */
 
         for (di = 0; di < H; di++)
-            for (dj = 0; dj < W; dj++)
-                for (i = 0; i < b; i++)
-                {
-                    int c = 0;
-
-                    /* Average the NxN source pixel block for each. */
+        {
+            const int r0 = (di * 2     < h) ? di * 2     : h - 1;
+            const int r1 = (di * 2 + 1 < h) ? di * 2 + 1 : h - 1;
 
-                    for (si = di * n; si < (di + 1) * n; si++)
-                        for (sj = dj * n; sj < (dj + 1) * n; sj++)
-                            c += src[(si * w + sj) * b + i];
+            for (dj = 0; dj < W; dj++)
+            {
+                const int c0 = (dj * 2     < w) ? dj * 2     : w - 1;
+                const int c1 = (dj * 2 + 1 < w) ? dj * 2 + 1 : w - 1;
 
-                    dst[(di * W + dj) * b + i] =
-                        (unsigned char) (c / (n * n));
-                }
+                for (i = 0; i < b; i++)
+                    dst[(di * W + dj) * b + i] = (unsigned char)
+                        ((src[(r0 * w + c0) * b + i] +
+                          src[(r0 * w + c1) * b + i] +
+                          src[(r1 * w + c0) * b + i] +
+                          src[(r1 * w + c1) * b + i] + 2) / 4);
+            }
+        }
 
         if (wn) *wn = W;
         if (hn) *hn = H;
@@ -291,30 +665,47 @@ void *image_scale(const void *p, int w, int h, int b, int *wn, int *hn, int n)
  */
 void image_white(void *p, int w, int h, int b)
 {
+    static const unsigned char mask[2][16] = {
+        { 0xFF, 0, 0xFF, 0, 0xFF, 0, 0xFF, 0,
+          0xFF, 0, 0xFF, 0, 0xFF, 0, 0xFF, 0 },
+        { 0xFF, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0xFF, 0,
+          0xFF, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0xFF, 0 },
+    };
+
     unsigned char *s = (unsigned char *) p;
 
-    int i;
+    int i = 0;
 
     assert(b >= 1 && b <= 4);
 
     if (b == 1 || b == 3)
     {
         memset(s, 0xFF, w * h * b);
+        return;
     }
-    else if (b == 2)
+
+    /* OR a mask over whole pixels, sixteen bytes at a time. */
+
+#if IMAGE_SSE2
     {
-        for (i = 0; i < w * h * b; i += 2)
-            s[i] = 0xFF;
+        const __m128i m = _mm_loadu_si128((const __m128i *) mask[b / 2 - 1]);
+
+        for (; i + 16 <= w * h * b; i += 16)
+            _mm_storeu_si128((__m128i *) (s + i),
+                             _mm_or_si128(m, _mm_loadu_si128((__m128i *)
+                                                             (s + i))));
     }
-    else
+#elif IMAGE_NEON
     {
-        for (i = 0; i < w * h * b; i += 4)
-        {
-            s[i + 0] = 0xFF;
-            s[i + 1] = 0xFF;
-            s[i + 2] = 0xFF;
-        }
+        const uint8x16_t m = vld1q_u8(mask[b / 2 - 1]);
+
+        for (; i + 16 <= w * h * b; i += 16)
+            vst1q_u8(s + i, vorrq_u8(m, vld1q_u8(s + i)));
     }
+#endif
+
+    for (; i < w * h * b; i++)
+        s[i] |= mask[b / 2 - 1][i % 16];
 }
 
 /*
@@ -332,20 +723,19 @@ void *image_flip(const void *p, int w, int h, int b, int hflip, int vflip)
 
     if ((q = malloc(w * b * h)))
     {
-        int r, c, i;
+        int r;
 
         for (r = 0; r < h; r++)
-            for (c = 0; c < w; c++)
-                for (i = 0; i < b; i++)
-                {
-                    int pr = vflip ? h - r - 1 : r;
-                    int pc = hflip ? w - c - 1 : c;
+        {
+            const int pr = vflip ? h - r - 1 : r;
 
-                    int qi = r  * w * b + c  * b + i;
-                    int pi = pr * w * b + pc * b + i;
+            const unsigned char *s = (const unsigned char *) p + pr * w * b;
 
-                    q[qi] = ((const unsigned char *) p)[pi];
-                }
+            if (hflip)
+                row_reverse(q + r * w * b, s, w, b);
+            else
+                memcpy(q + r * w * b, s, w * b);
+        }
         return q;
     }
     return NULL;
@@ -7,9 +7,11 @@ void  image_size(int *, int *, int, int);
 void  image_near2(int *, int *, int, int);
 
 void *image_load(const char *, int *, int *, int *);
+void *image_load_scaled(const char *, int *, int *, int *, int);
 
 void *image_next2(const void *, int, int, int, int *, int *);
 void *image_scale(const void *, int, int, int, int *, int *, int);
+void *image_mip  (const void *, int, int, int, int *, int *);
 void  image_white(      void *, int, int, int);
 void *image_flip (const void *, int, int, int, int, int);
 
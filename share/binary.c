@@ -18,6 +18,7 @@
 
 #include <SDL_endian.h>
 
+#include "binary.h"
 #include "fs.h"
 
 /*---------------------------------------------------------------------------*/
@@ -71,10 +72,26 @@ void put_short(fs_file fout, short s)
 
 void put_array(fs_file fout, const float *v, size_t n)
 {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
     size_t i;
 
     for (i = 0; i < n; i++)
         put_float(fout, v[i]);
+#else
+    fs_write(v, FLOAT_BYTES, n, fout);
+#endif
+}
+
+void put_index_array(fs_file fout, const int *v, size_t n)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        put_index(fout, v[i]);
+#else
+    fs_write(v, INDEX_BYTES, n, fout);
+#endif
 }
 
 /*---------------------------------------------------------------------------*/
@@ -137,10 +154,26 @@ short get_short(fs_file fin)
 
 void get_array(fs_file fin, float *v, size_t n)
 {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
     size_t i;
 
     for (i = 0; i < n; i++)
         v[i] = get_float(fin);
+#else
+    fs_read(v, FLOAT_BYTES, n, fin);
+#endif
+}
+
+void get_index_array(fs_file fin, int *v, size_t n)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        v[i] = get_index(fin);
+#else
+    fs_read(v, INDEX_BYTES, n, fin);
+#endif
 }
 
 /*---------------------------------------------------------------------------*/
@@ -37,6 +37,9 @@ int CONFIG_TEXTURES;
 int CONFIG_REFLECTION;
 int CONFIG_MULTISAMPLE;
 int CONFIG_MIPMAP;
+int CONFIG_UPLOAD_BUDGET;
+int CONFIG_TEXTURE_BUDGET;
+int CONFIG_TEXTURE_CACHE;
 int CONFIG_ANISO;
 int CONFIG_BACKGROUND;
 int CONFIG_SHADOW;
@@ -139,6 +142,9 @@ static struct
     { &CONFIG_REFLECTION,   "reflection",   1 },
     { &CONFIG_MULTISAMPLE,  "multisample",  0 },
     { &CONFIG_MIPMAP,       "mipmap",       1 },
+    { &CONFIG_UPLOAD_BUDGET, "upload_budget", 4 },
+    { &CONFIG_TEXTURE_BUDGET, "texture_budget", 64 },
+    { &CONFIG_TEXTURE_CACHE, "texture_cache", 256 },
     { &CONFIG_ANISO,        "aniso",        0 },
     { &CONFIG_BACKGROUND,   "background",   1 },
     { &CONFIG_SHADOW,       "shadow",       1 },
@@ -34,6 +34,9 @@ extern int CONFIG_TEXTURES;
 extern int CONFIG_REFLECTION;
 extern int CONFIG_MULTISAMPLE;
 extern int CONFIG_MIPMAP;
+extern int CONFIG_UPLOAD_BUDGET;
+extern int CONFIG_TEXTURE_BUDGET;
+extern int CONFIG_TEXTURE_CACHE;
 extern int CONFIG_ANISO;
 extern int CONFIG_BACKGROUND;
 extern int CONFIG_SHADOW;
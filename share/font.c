@@ -24,6 +24,385 @@
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Decode one UTF-8 character and step past it.  Malformed input and
+ * code points beyond the reach of TTF_GlyphMetrics read as '?'.
+ */
+static int utf8_next(const char **s)
+{
+    const unsigned char *p = (const unsigned char *) *s;
+
+    int c = *p++;
+    int n = 0;
+
+    if      (c < 0x80)           n = 0;
+    else if ((c & 0xE0) == 0xC0) n = 1, c &= 0x1F;
+    else if ((c & 0xF0) == 0xE0) n = 2, c &= 0x0F;
+    else if ((c & 0xF8) == 0xF0) n = 3, c &= 0x07;
+    else                         c = '?';
+
+    while (n-- > 0)
+    {
+        if ((*p & 0xC0) != 0x80)
+        {
+            c = '?';
+            break;
+        }
+        c = (c << 6) | (*p++ & 0x3F);
+    }
+
+    *s = (const char *) p;
+
+    return (c > 0xFFFF) ? '?' : c;
+}
+
+static void utf8_put(char *s, int c)
+{
+    if (c < 0x80)
+        *s++ = (char) c;
+    else if (c < 0x800)
+    {
+        *s++ = (char) (0xC0 |  (c >> 6));
+        *s++ = (char) (0x80 |  (c        & 0x3F));
+    }
+    else
+    {
+        *s++ = (char) (0xE0 |  (c >> 12));
+        *s++ = (char) (0x80 | ((c >> 6)  & 0x3F));
+        *s++ = (char) (0x80 |  (c        & 0x3F));
+    }
+    *s = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void atlas_free(struct atlas *a)
+{
+    if (a->pagec)
+        glDeleteTextures(a->pagec, a->pagev);
+
+    free(a->pagev);
+    free(a->glyphv);
+
+    memset(a, 0, sizeof (*a));
+}
+
+static struct glyph *atlas_slot(struct atlas *a, int c)
+{
+    unsigned int i = ((unsigned int) c * 2654435761u) & (a->glyphm - 1);
+
+    while (a->glyphv[i].c && a->glyphv[i].c != c)
+        i = (i + 1) & (a->glyphm - 1);
+
+    return a->glyphv + i;
+}
+
+/*
+ * Find the cached metrics of a glyph, measuring it on first use.
+ */
+static struct glyph *atlas_glyph(struct atlas *a, TTF_Font *ttf, int c)
+{
+    struct glyph *g;
+
+    /* Keep the table at most half full. */
+
+    if (a->glyphc * 2 >= a->glyphm)
+    {
+        struct glyph *v = a->glyphv;
+        int           m = a->glyphm;
+        int           i;
+
+        a->glyphm = m ? m * 2 : 256;
+
+        if (!(a->glyphv = calloc(a->glyphm, sizeof (*v))))
+        {
+            a->glyphv = v;
+            a->glyphm = m;
+            return NULL;
+        }
+
+        for (i = 0; i < m; i++)
+            if (v[i].c)
+                *atlas_slot(a, v[i].c) = v[i];
+
+        free(v);
+    }
+
+    if ((g = atlas_slot(a, c))->c == 0)
+    {
+        char str[4];
+        int w = 0, h = 0;
+
+        utf8_put(str, c);
+
+        g->c    = c;
+        g->adv  = 0;
+        g->page = -1;
+
+        TTF_GlyphMetrics(ttf, (Uint16) c, NULL, NULL, NULL, NULL, &g->adv);
+        TTF_SizeUTF8(ttf, str, &w, &h);
+
+        g->w = MAX(w, g->adv);
+
+        a->glyphc++;
+    }
+    return g;
+}
+
+/*
+ * Step the pen past a cell of the given width, moving to the next row
+ * as needed.  Return the cell position, or 0 if the page is full.
+ */
+static int atlas_fit(const struct atlas *a, int *x, int *y, int w,
+                     int *cx, int *cy)
+{
+    if (*x + w + 1 > a->side)
+    {
+        *x  = 1;
+        *y += a->h + 1;
+    }
+
+    if (*y + a->h + 1 > a->side || w + 2 > a->side)
+        return 0;
+
+    *cx = *x;
+    *cy = *y;
+    *x += w + 1;
+
+    return 1;
+}
+
+static int atlas_page(struct atlas *a)
+{
+    GLuint *v;
+    GLuint  o;
+    void   *z;
+
+    if (!(v = realloc(a->pagev, (a->pagec + 1) * sizeof (*v))))
+        return 0;
+
+    a->pagev = v;
+
+    if (!(z = calloc(a->side, a->side)))
+        return 0;
+
+    /* Clear the page so that filtering never reaches stray texels. */
+
+    glGenTextures(1, &o);
+    glBindTexture(GL_TEXTURE_2D, o);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, a->side, a->side, 0,
+                 GL_ALPHA, GL_UNSIGNED_BYTE, z);
+
+    free(z);
+
+    a->pagev[a->pagec++] = o;
+
+    a->x = 1;
+    a->y = 1;
+
+    return 1;
+}
+
+/*
+ * Render a glyph into the next free cell of the last page.
+ */
+static void atlas_draw(struct atlas *a, TTF_Font *ttf, struct glyph *g)
+{
+    SDL_Color    col = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface *srf;
+    char str[4];
+
+    utf8_put(str, g->c);
+
+    if (!atlas_fit(a, &a->x, &a->y, g->w, &g->x, &g->y))
+        return;
+
+    g->page = a->pagec - 1;
+
+    if ((srf = TTF_RenderUTF8_Blended(ttf, str, col)))
+    {
+        const int w = MIN(srf->w, g->w);
+        const int h = MIN(srf->h, a->h);
+
+        unsigned char *p;
+
+        /* Keep only the alpha, which is all the text modulates. */
+
+        if ((p = malloc(w * h)))
+        {
+            const Uint32 m = srf->format->Amask;
+            const Uint32 k = srf->format->Ashift;
+
+            int r, c;
+
+            SDL_LockSurface(srf);
+
+            for (r = 0; r < h; r++)
+            {
+                const Uint32 *s = (const Uint32 *)
+                    ((const Uint8 *) srf->pixels + r * srf->pitch);
+
+                for (c = 0; c < w; c++)
+                    p[r * w + c] = (unsigned char) ((s[c] & m) >> k);
+            }
+
+            SDL_UnlockSurface(srf);
+
+            glBindTexture(GL_TEXTURE_2D, a->pagev[g->page]);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, g->x, g->y, w, h,
+                            GL_ALPHA, GL_UNSIGNED_BYTE, p);
+            free(p);
+        }
+        SDL_FreeSurface(srf);
+    }
+}
+
+static struct atlas *font_atlas(struct font *ft, int i, TTF_Font **ttf)
+{
+    struct atlas *a = NULL;
+
+    if (ft && i >= 0 && i < ARRAYSIZE(ft->ttf) && (*ttf = ft->ttf[i]))
+    {
+        a = &ft->atlas[i];
+
+        /* Size the pages to hold a few hundred cells, within limits. */
+
+        if (a->h == 0)
+        {
+            a->h    = TTF_FontHeight(*ttf);
+            a->side = 64;
+
+            while (a->side < a->h * 16 && a->side < 2048 &&
+                   a->side < gli.max_texture_size)
+                a->side *= 2;
+        }
+    }
+    return a;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Return the advance of the next character of the given string at the
+ * given size, and step past it.
+ */
+int font_advance(struct font *ft, int i, const char **text)
+{
+    TTF_Font     *ttf;
+    struct atlas *a;
+    struct glyph *g;
+
+    int c = utf8_next(text);
+
+    if ((a = font_atlas(ft, i, &ttf)) && (g = atlas_glyph(a, ttf, c)))
+        return g->adv;
+
+    return 0;
+}
+
+int font_width(struct font *ft, int i, const char *text)
+{
+    int w = 0;
+
+    while (text && *text)
+        w += font_advance(ft, i, &text);
+
+    return w;
+}
+
+int font_height(struct font *ft, int i)
+{
+    TTF_Font     *ttf;
+    struct atlas *a;
+
+    return (a = font_atlas(ft, i, &ttf)) ? a->h : 0;
+}
+
+/*
+ * Lay out the given string as a row of quads, rendering any glyphs not
+ * yet on the last page of the atlas.  Return the quad count and give
+ * the page texture and the text extent.
+ */
+int font_layout(struct font *ft, int i, const char *text,
+                struct font_quad *qv, GLuint *page, int *w, int *h)
+{
+    TTF_Font     *ttf;
+    struct atlas *a;
+    struct glyph *g;
+
+    const char *p;
+
+    int n = 0;
+    int x = 0;
+
+    *page = 0;
+    *w    = 0;
+    *h    = 0;
+
+    if (!text || !*text || !(a = font_atlas(ft, i, &ttf)))
+        return 0;
+
+    /* Start a new page if this string's new glyphs won't fit the last. */
+
+    if (a->pagec)
+    {
+        int px = a->x;
+        int py = a->y;
+        int cx, cy;
+
+        for (p = text; *p; )
+            if ((g = atlas_glyph(a, ttf, utf8_next(&p))) &&
+                g->page != a->pagec - 1 &&
+                !atlas_fit(a, &px, &py, g->w, &cx, &cy))
+            {
+                atlas_page(a);
+                break;
+            }
+    }
+    else atlas_page(a);
+
+    if (!a->pagec)
+        return 0;
+
+    /* Render any missing glyphs and emit a quad for each. */
+
+    for (p = text; *p; )
+        if ((g = atlas_glyph(a, ttf, utf8_next(&p))))
+        {
+            if (g->page != a->pagec - 1)
+                atlas_draw(a, ttf, g);
+
+            if (g->page == a->pagec - 1 && g->w > 0)
+            {
+                qv[n].x  = x;
+                qv[n].w  = g->w;
+                qv[n].h  = a->h;
+                qv[n].s0 = (GLfloat) (g->x)          / a->side;
+                qv[n].t0 = (GLfloat) (g->y)          / a->side;
+                qv[n].s1 = (GLfloat) (g->x + g->w)   / a->side;
+                qv[n].t1 = (GLfloat) (g->y + a->h)   / a->side;
+
+                *w = MAX(*w, x + g->w);
+                n++;
+            }
+            x += g->adv;
+        }
+
+    *page = a->pagev[a->pagec - 1];
+    *w    = MAX(*w, x);
+    *h    = a->h;
+
+    return n;
+}
+
+/*---------------------------------------------------------------------------*/
+
 int font_load(struct font *ft, const char *path, int sizes[3])
 {
     if (ft && path && *path)
@@ -59,6 +438,9 @@ void font_free(struct font *ft)
             if (ft->ttf[i])
                 TTF_CloseFont(ft->ttf[i]);
 
+        for (i = 0; i < ARRAYSIZE(ft->atlas); i++)
+            atlas_free(&ft->atlas[i]);
+
         if (ft->rwops)
             SDL_RWclose(ft->rwops);
 
@@ -5,6 +5,47 @@
 #include <SDL_rwops.h>
 
 #include "base_config.h"
+#include "glext.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Glyph atlas.  Each font size rasterizes its glyphs once into shared
+ * alpha textures, and text is drawn as one quad per glyph.  A string is
+ * always laid out on a single page, so that it draws with one texture.
+ */
+
+struct glyph
+{
+    int c;                              /* Code point, or 0 if unused        */
+    int adv;                            /* Pen advance                       */
+    int w;                              /* Cell width                        */
+    int page;                           /* Page last rendered to, or -1      */
+    int x, y;                           /* Cell position on that page        */
+};
+
+struct atlas
+{
+    int h;                              /* Cell height                       */
+    int side;                           /* Page width and height             */
+    int x, y;                           /* Next free cell on the last page   */
+
+    GLuint *pagev;
+    int     pagec;
+
+    struct glyph *glyphv;               /* Open-addressed by code point      */
+    int           glyphc;
+    int           glyphm;
+};
+
+struct font_quad
+{
+    int x, w, h;
+    GLfloat s0, t0;
+    GLfloat s1, t1;
+};
+
+/*---------------------------------------------------------------------------*/
 
 struct font
 {
@@ -14,6 +55,8 @@ struct font
     SDL_RWops *rwops;
     void      *data;
     int        datalen;
+
+    struct atlas atlas[3];
 };
 
 int  font_load(struct font *, const char *path, int sizes[3]);
@@ -22,4 +65,12 @@ void font_free(struct font *);
 int  font_init(void);
 void font_quit(void);
 
+int  font_advance(struct font *, int, const char **);
+int  font_width  (struct font *, int, const char *);
+int  font_height (struct font *, int);
+int  font_layout (struct font *, int, const char *, struct font_quad *,
+                  GLuint *, int *, int *);
+
+/*---------------------------------------------------------------------------*/
+
 #endif
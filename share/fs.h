@@ -14,7 +14,8 @@ int         fs_add_path_with_archives(const char *);
 int         fs_set_write_dir(const char *);
 const char *fs_get_write_dir(void);
 
-int fs_exists(const char *);
+int  fs_exists(const char *);
+long fs_mtime(const char *);
 int fs_remove(const char *);
 int fs_rename(const char *, const char *);
 
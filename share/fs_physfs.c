@@ -174,6 +174,13 @@ int fs_exists(const char *path)
     return PHYSFS_exists(path);
 }
 
+long fs_mtime(const char *path)
+{
+    PHYSFS_sint64 t = PHYSFS_getLastModTime(path);
+
+    return t < 0 ? 0 : (long) t;
+}
+
 int fs_remove(const char *path)
 {
     return PHYSFS_delete(path);
@@ -17,6 +17,7 @@
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include "fs.h"
 #include "dir.h"
@@ -301,6 +302,22 @@ int fs_exists(const char *path)
     return 0;
 }
 
+long fs_mtime(const char *path)
+{
+    struct stat buf;
+    char *real;
+    long t = 0;
+
+    if ((real = real_path(path)))
+    {
+        if (stat(real, &buf) == 0)
+            t = (long) buf.st_mtime;
+
+        free(real);
+    }
+    return t;
+}
+
 int fs_remove(const char *path)
 {
     char *real;
@@ -317,6 +317,9 @@ static struct s_full item[GEOM_MAX];
 
 static int back_state = 0;
 
+static float *item_pv;                  /* Item positions, sorted by kind */
+static int    item_pm;
+
 /*---------------------------------------------------------------------------*/
 
 void geom_init(void)
@@ -347,6 +350,11 @@ void geom_free(void)
 
     for (i = 0; i < GEOM_MAX; i++)
         sol_free_full(&item[i]);
+
+    free(item_pv);
+
+    item_pv = NULL;
+    item_pm = 0;
 }
 
 void geom_step(float dt)
@@ -364,7 +372,7 @@ void geom_step(float dt)
 
 /*---------------------------------------------------------------------------*/
 
-static struct s_draw *item_file(const struct v_item *hp)
+static int item_geom(const struct v_item *hp)
 {
     int g = GEOM_COIN;
 
@@ -382,7 +390,12 @@ static struct s_draw *item_file(const struct v_item *hp)
         }
     }
 
-    return &item[g].draw;
+    return g;
+}
+
+static struct s_draw *item_file(const struct v_item *hp)
+{
+    return &item[item_geom(hp)].draw;
 }
 
 void item_color(const struct v_item *hp, float *c)
@@ -431,6 +444,99 @@ void item_draw(struct s_rend *rend,
     glPopMatrix();
 }
 
+void item_draw_all(struct s_rend *rend,
+                   const struct v_item *hv, int hc,
+                   const GLfloat *M, float t)
+{
+    const GLfloat s = ITEM_RADIUS;
+
+    int pc[GEOM_MAX + 1];
+    int pi[GEOM_MAX];
+    int g, hi, i;
+
+    /* Grow the position list as needed, or draw one at a time. */
+
+    if (hc > item_pm)
+    {
+        float *v;
+
+        if ((v = (float *) realloc(item_pv, hc * 3 * sizeof (float))))
+        {
+            item_pv = v;
+            item_pm = hc;
+        }
+        else
+        {
+            for (hi = 0; hi < hc; hi++)
+                if (hv[hi].t != ITEM_NONE)
+                {
+                    glPushMatrix();
+                    {
+                        glTranslatef(hv[hi].p[0],
+                                     hv[hi].p[1],
+                                     hv[hi].p[2]);
+                        item_draw(rend, hv + hi, M, t);
+                    }
+                    glPopMatrix();
+                }
+            return;
+        }
+    }
+
+    /* Sort the item positions by kind, counting first. */
+
+    memset(pc, 0, sizeof (pc));
+
+    for (hi = 0; hi < hc; hi++)
+        if (hv[hi].t != ITEM_NONE)
+            pc[item_geom(hv + hi) + 1]++;
+
+    for (g = 0; g < GEOM_MAX; g++)
+    {
+        pc[g + 1] += pc[g];
+        pi[g]      = pc[g];
+    }
+
+    for (hi = 0; hi < hc; hi++)
+        if (hv[hi].t != ITEM_NONE)
+            v_cpy(item_pv + pi[item_geom(hv + hi)]++ * 3, hv[hi].p);
+
+    /* Draw each kind as a batch, billboards before models. */
+
+    for (g = 0; g < GEOM_MAX; g++)
+    {
+        struct s_draw *draw = &item[g].draw;
+
+        const float *pv = item_pv + pc[g] * 3;
+        const int    n  = pc[g + 1] - pc[g];
+
+        if (n == 0)
+            continue;
+
+        glDepthMask(GL_FALSE);
+        {
+            sol_bill_inst(draw, rend, M, t, pv, n, s);
+        }
+        glDepthMask(GL_TRUE);
+
+        if (!sol_draw_inst(draw, rend, pv, n, s))
+        {
+            for (i = 0; i < n; i++)
+            {
+                glPushMatrix();
+                {
+                    glTranslatef(pv[i * 3 + 0],
+                                 pv[i * 3 + 1],
+                                 pv[i * 3 + 2]);
+                    glScalef(s, s, s);
+                    sol_draw(draw, rend, 0, 1);
+                }
+                glPopMatrix();
+            }
+        }
+    }
+}
+
 /*---------------------------------------------------------------------------*/
 
 void back_init(const char *name)
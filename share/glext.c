@@ -18,6 +18,10 @@
 #include "glext.h"
 #include "log.h"
 
+#if ENABLE_HEADLESS
+#include <GL/osmesa.h>
+#endif
+
 struct gl_info gli;
 
 /*---------------------------------------------------------------------------*/
@@ -99,8 +103,29 @@ int glext_assert(const char *ext)
 
 /*---------------------------------------------------------------------------*/
 
+#if ENABLE_HEADLESS
+
+/* Look entry points up in OSMesa when it holds the current context. */
+
+static void *glext_proc(const char *name)
+{
+    if (OSMesaGetCurrentContext())
+    {
+        OSMESAproc proc = OSMesaGetProcAddress(name);
+        void      *ptr;
+
+        memcpy(&ptr, &proc, sizeof (void *));
+        return ptr;
+    }
+    return SDL_GL_GetProcAddress(name);
+}
+
+#else
+#define glext_proc SDL_GL_GetProcAddress
+#endif
+
 #define SDL_GL_GFPA(fun, str) do {       \
-    ptr = SDL_GL_GetProcAddress(str);    \
+    ptr = glext_proc(str);               \
     memcpy(&fun, &ptr, sizeof (void *)); \
 } while(0)
 
@@ -72,6 +72,9 @@
 #ifndef GL_DYNAMIC_DRAW
 #define GL_DYNAMIC_DRAW               0x88E8
 #endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW                0x88E0
+#endif
 
 #ifndef GL_POINT_SPRITE
 #define GL_POINT_SPRITE               0x8861
@@ -299,5 +302,11 @@ struct gl_info
 
 extern struct gl_info gli;
 
+/*---------------------------------------------------------------------------*/
+
+#if ENABLE_GLSTAT
+#include "glstat.h"
+#endif
+
 /*---------------------------------------------------------------------------*/
 #endif
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLSTAT_IMPL
+
+#include "glstat.h"
+#include "common.h"
+#include "fs.h"
+#include "log.h"
+
+/*---------------------------------------------------------------------------*/
+
+static struct glstat curr;
+static struct glstat ring[GLSTAT_RING];
+
+static int ring_n;
+static int ring_i;
+
+static int frame;
+static int stack_mode = GL_MODELVIEW;
+static int stack_depth;
+
+/* Running totals for the overlay, reported about once a second. */
+
+static struct glstat sum;
+static int sum_n;
+
+static char text[MAXSTR];
+
+/*---------------------------------------------------------------------------*/
+
+static int pixel_size(GLenum f)
+{
+    switch (f)
+    {
+    case GL_RGBA:            return 4;
+    case GL_RGB:             return 3;
+    case GL_LUMINANCE_ALPHA: return 2;
+    default:                 return 1;
+    }
+}
+
+void glstat_DrawArrays(GLenum m, GLint i, GLsizei n)
+{
+    curr.draw_calls += 1;
+    curr.verts      += n;
+    glDrawArrays(m, i, n);
+}
+
+void glstat_DrawElements(GLenum m, GLsizei n, GLenum t, const GLvoid *p)
+{
+    curr.draw_calls += 1;
+    curr.verts      += n;
+    glDrawElements(m, n, t, p);
+}
+
+void glstat_BindTexture(GLenum t, GLuint o)
+{
+    curr.tex_binds += 1;
+    glBindTexture(t, o);
+}
+
+void glstat_TexImage2D(GLenum t, GLint l, GLint i, GLsizei w, GLsizei h,
+                       GLint b, GLenum f, GLenum y, const GLvoid *p)
+{
+    curr.tex_bytes += w * h * pixel_size(f);
+    glTexImage2D(t, l, i, w, h, b, f, y, p);
+}
+
+void glstat_BindBuffer(GLenum t, GLuint o)
+{
+    curr.buf_binds += 1;
+    glBindBuffer_(t, o);
+}
+
+void glstat_BufferData(GLenum t, long n, const GLvoid *p, GLenum u)
+{
+    if (p)
+        curr.buf_bytes += (int) n;
+    glBufferData_(t, n, p, u);
+}
+
+void glstat_BufferSubData(GLenum t, long i, long n, const GLvoid *p)
+{
+    curr.buf_bytes += (int) n;
+    glBufferSubData_(t, i, n, p);
+}
+
+void glstat_Materialfv(GLenum f, GLenum e, const GLfloat *v)
+{
+    curr.mtrl_calls += 1;
+    glMaterialfv(f, e, v);
+}
+
+void glstat_Enable(GLenum e)
+{
+    curr.state_calls += 1;
+    glEnable(e);
+}
+
+void glstat_Disable(GLenum e)
+{
+    curr.state_calls += 1;
+    glDisable(e);
+}
+
+void glstat_MatrixMode(GLenum m)
+{
+    stack_mode = m;
+    glMatrixMode(m);
+}
+
+void glstat_PushMatrix(void)
+{
+    /* Only the model-view stack is deep enough to be interesting. */
+
+    if (stack_mode == GL_MODELVIEW && ++stack_depth > curr.push_max)
+        curr.push_max = stack_depth;
+
+    glPushMatrix();
+}
+
+void glstat_PopMatrix(void)
+{
+    if (stack_mode == GL_MODELVIEW && stack_depth > 0)
+        stack_depth--;
+
+    glPopMatrix();
+}
+
+#if !ENABLE_OPENGLES
+void glstat_UseProgram(GLuint p)
+{
+    curr.prog_binds += 1;
+    glUseProgram_(p);
+}
+#endif
+
+/* Draw calls issued by GUI painting, reported by the GUI itself. */
+
+void glstat_gui(int n)
+{
+    curr.gui_draws += n;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void glstat_sum(void)
+{
+    sum.ms          += curr.ms;
+    sum.draw_calls  += curr.draw_calls;
+    sum.verts       += curr.verts;
+    sum.buf_binds   += curr.buf_binds;
+    sum.buf_bytes   += curr.buf_bytes;
+    sum.tex_binds   += curr.tex_binds;
+    sum.tex_bytes   += curr.tex_bytes;
+    sum.mtrl_calls  += curr.mtrl_calls;
+    sum.state_calls += curr.state_calls;
+    sum.prog_binds  += curr.prog_binds;
+    sum.gui_draws   += curr.gui_draws;
+
+    if (sum.push_max < curr.push_max)
+        sum.push_max = curr.push_max;
+
+    sum_n++;
+
+    /* Format the per-frame averages once enough time has passed. */
+
+    if (sum.ms >= 1000)
+    {
+        sprintf(text, "draw %d  vert %dk  tex %d/%dk  buf %d/%dk  "
+                "mtrl %d  state %d  push %d  gui %d",
+                sum.draw_calls / sum_n,
+                sum.verts      / sum_n / 1000,
+                sum.tex_binds  / sum_n,
+                sum.tex_bytes  / sum_n / 1024,
+                sum.buf_binds  / sum_n,
+                sum.buf_bytes  / sum_n / 1024,
+                sum.mtrl_calls / sum_n,
+                sum.state_calls / sum_n,
+                sum.push_max,
+                sum.gui_draws  / sum_n);
+
+        memset(&sum, 0, sizeof (sum));
+        sum_n = 0;
+    }
+}
+
+void glstat_frame(int ms)
+{
+    if (frame++ == 0)
+        atexit(glstat_dump);
+
+    curr.ms = ms;
+
+    glstat_sum();
+
+    ring[ring_i] = curr;
+
+    ring_i = (ring_i + 1) % GLSTAT_RING;
+
+    if (ring_n < GLSTAT_RING)
+        ring_n++;
+
+    memset(&curr, 0, sizeof (curr));
+
+    /* Nesting carries over into the next frame, if it is unbalanced. */
+
+    curr.push_max = stack_depth;
+}
+
+const char *glstat_text(void)
+{
+    return text;
+}
+
+void glstat_dump(void)
+{
+    fs_file fp;
+    int i;
+
+    if ((fp = fs_open(GLSTAT_FILE, "w")))
+    {
+        fs_printf(fp, "frame,ms,draw_calls,verts,buf_binds,buf_bytes,"
+                  "tex_binds,tex_bytes,mtrl_calls,state_calls,prog_binds,"
+                  "push_max,gui_draws\n");
+
+        for (i = 0; i < ring_n; i++)
+        {
+            const struct glstat *s =
+                ring + (ring_i - ring_n + i + GLSTAT_RING) % GLSTAT_RING;
+
+            fs_printf(fp, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+                      frame - ring_n + i,
+                      s->ms,
+                      s->draw_calls,
+                      s->verts,
+                      s->buf_binds,
+                      s->buf_bytes,
+                      s->tex_binds,
+                      s->tex_bytes,
+                      s->mtrl_calls,
+                      s->state_calls,
+                      s->prog_binds,
+                      s->push_max,
+                      s->gui_draws);
+        }
+        fs_close(fp);
+
+        log_printf("Wrote GL statistics for %d frames to %s\n",
+                   ring_n, GLSTAT_FILE);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,100 @@
+#ifndef GLSTAT_H
+#define GLSTAT_H
+
+#include "glext.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * GL call and state-change counters.  Built with ENABLE_GLSTAT, every
+ * file  that includes glext.h has  the GL entry points below routed
+ * through a counting wrapper.  The last GLSTAT_RING frames are kept and
+ * written to GLSTAT_FILE on exit.
+ */
+
+#define GLSTAT_RING 600
+#define GLSTAT_FILE "glstat.csv"
+
+/* Widest overlay text, for sizing the label that displays it. */
+
+#define GLSTAT_TEXT_MAX \
+    "draw 0000  vert 0000k  tex 0000/0000k  buf 0000/0000k  " \
+    "mtrl 0000  state 0000  push 00  gui 000"
+
+struct glstat
+{
+    int ms;
+
+    int draw_calls;
+    int verts;
+    int buf_binds;
+    int buf_bytes;
+    int tex_binds;
+    int tex_bytes;
+    int mtrl_calls;
+    int state_calls;
+    int prog_binds;
+    int push_max;
+    int gui_draws;
+};
+
+void        glstat_gui(int);
+void        glstat_frame(int);
+const char *glstat_text(void);
+void        glstat_dump(void);
+
+/*---------------------------------------------------------------------------*/
+
+void glstat_DrawArrays(GLenum, GLint, GLsizei);
+void glstat_DrawElements(GLenum, GLsizei, GLenum, const GLvoid *);
+void glstat_BindTexture(GLenum, GLuint);
+void glstat_TexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint,
+                       GLenum, GLenum, const GLvoid *);
+void glstat_BindBuffer(GLenum, GLuint);
+void glstat_BufferData(GLenum, long, const GLvoid *, GLenum);
+void glstat_BufferSubData(GLenum, long, long, const GLvoid *);
+void glstat_Materialfv(GLenum, GLenum, const GLfloat *);
+void glstat_Enable(GLenum);
+void glstat_Disable(GLenum);
+void glstat_MatrixMode(GLenum);
+void glstat_PushMatrix(void);
+void glstat_PopMatrix(void);
+
+#if !ENABLE_OPENGLES
+void glstat_UseProgram(GLuint);
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+/* Everywhere but the wrappers themselves, call through the counters. */
+
+#ifndef GLSTAT_IMPL
+
+#undef glBindBuffer_
+#undef glBufferData_
+#undef glBufferSubData_
+
+#define glDrawArrays(m, i, n)        glstat_DrawArrays(m, i, n)
+#define glDrawElements(m, n, t, p)   glstat_DrawElements(m, n, t, p)
+#define glBindTexture(t, o)          glstat_BindTexture(t, o)
+#define glTexImage2D(t, l, i, w, h, b, f, y, p) \
+    glstat_TexImage2D(t, l, i, w, h, b, f, y, p)
+#define glBindBuffer_(t, o)          glstat_BindBuffer(t, o)
+#define glBufferData_(t, n, p, u)    glstat_BufferData(t, n, p, u)
+#define glBufferSubData_(t, i, n, p) glstat_BufferSubData(t, i, n, p)
+#define glMaterialfv(f, e, v)        glstat_Materialfv(f, e, v)
+#define glEnable(e)                  glstat_Enable(e)
+#define glDisable(e)                 glstat_Disable(e)
+#define glMatrixMode(m)              glstat_MatrixMode(m)
+#define glPushMatrix()               glstat_PushMatrix()
+#define glPopMatrix()                glstat_PopMatrix()
+
+#if !ENABLE_OPENGLES
+#define glUseProgram_(p)             glstat_UseProgram(p)
+#endif
+
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+#endif
@@ -26,6 +26,7 @@
 #include "common.h"
 #include "font.h"
 #include "theme.h"
+#include "thumb.h"
 
 #include "fs.h"
 #include "fs_rwops.h"
@@ -45,7 +46,7 @@ const GLubyte gui_shd[4] = { 0x00, 0x00, 0x00, 0x80 };  /* Shadow */
 
 /*---------------------------------------------------------------------------*/
 
-#define WIDGET_MAX 256
+#define WIDGET_INIT 256
 
 #define GUI_FREE   0
 #define GUI_HARRAY 1
@@ -64,6 +65,9 @@ const GLubyte gui_shd[4] = { 0x00, 0x00, 0x00, 0x80 };  /* Shadow */
 #define GUI_FILL   2
 #define GUI_HILITE 4
 #define GUI_RECT   8
+#define GUI_DIRTY  16           /* Size must be measured again */
+#define GUI_MOVED  32           /* Area must be distributed again */
+#define GUI_THUMB  64           /* Image is a region of the thumbnail atlas */
 
 #define GUI_LINES 8
 
@@ -84,14 +88,21 @@ struct widget
 
     int     x, y;
     int     w, h;
+    int     par;
     int     car;
     int     cdr;
 
+    int     nw, nh;             /* Natural size, from the last measure */
+
     GLuint  image;
     GLfloat scale;
+    GLfloat uv[4];
 
     int     text_w;
     int     text_h;
+    int     text_off;
+    int     text_cnt;
+    int     text_cap;
 
     enum trunc trunc;
 };
@@ -100,7 +111,10 @@ struct widget
 
 /* GUI widget state */
 
-static struct widget widget[WIDGET_MAX];
+static struct widget *widget;
+static int            widget_max;
+static int            widget_free;
+
 static int           active;
 static int           hovered;
 static int           clicked;
@@ -120,6 +134,15 @@ static int cursor_st = 0;
 
 static struct theme curr_theme;
 
+/* Loaded fonts. */
+
+#define FONT_MAX 4
+
+static struct font fonts[FONT_MAX];
+static int         fontc;
+
+static int font_sizes[3];
+
 /*---------------------------------------------------------------------------*/
 
 static int gui_hot(int id)
@@ -137,21 +160,15 @@ static int gui_size(void)
 
 /*---------------------------------------------------------------------------*/
 
-/* Vertex buffer definitions for widget rendering. */
+/* Vertex definitions for widget geometry, relative to widget centers. */
 
 /* Vertex count */
 
 #define RECT_VERT 16
-#define TEXT_VERT  8
 #define IMAGE_VERT 4
+#define GLYPH_VERT 12
 
-#define WIDGET_VERT (RECT_VERT + MAX(TEXT_VERT, IMAGE_VERT))
-
-/* Element count */
-
-#define RECT_ELEM 28
-
-#define WIDGET_ELEM (RECT_ELEM)
+#define WIDGET_VERT (RECT_VERT + IMAGE_VERT)
 
 struct vert
 {
@@ -160,9 +177,17 @@ struct vert
     GLshort p[2];
 };
 
-static struct vert vert_buf[WIDGET_MAX * WIDGET_VERT];
-static GLuint      vert_vbo = 0;
-static GLuint      vert_ebo = 0;
+static struct vert *vert_buf = NULL;
+
+/*
+ * Glyph quads are kept in a pool of their own.  Each text widget holds
+ * a range of it, reused while the text fits, and abandoned ranges are
+ * reclaimed when the pool fills.
+ */
+
+static struct vert *text_buf = NULL;
+static int          text_len = 0;
+static int          text_max = 0;
 
 /*---------------------------------------------------------------------------*/
 
@@ -181,86 +206,272 @@ static void set_vert(struct vert *v, int x, int y,
 
 /*---------------------------------------------------------------------------*/
 
-static void draw_enable(GLboolean c, GLboolean u, GLboolean p)
+/*
+ * GUI batch.  Painting transforms widget geometry to the screen and
+ * gathers it here as triangles, in runs of a single texture.  At the end
+ * of a paint, runs are ordered by layer and texture, merged, and drawn
+ * from one streaming VBO.
+ */
+
+#define LAYER_RECT   0
+#define LAYER_TEXT   1
+#define LAYER_CURSOR 2
+
+struct batch_vert
+{
+    GLubyte c[4];
+    GLfloat u[2];
+    GLfloat p[2];
+};
+
+struct batch_run
 {
-    glBindBuffer_(GL_ARRAY_BUFFER,         vert_vbo);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, vert_ebo);
+    int    layer;
+    GLuint tex;
+    int    seq;
+    int    off;
+    int    n;
+};
 
-    if (c)
-    {
-        glEnableClientState(GL_COLOR_ARRAY);
-        glColorPointer   (4, GL_UNSIGNED_BYTE, sizeof (struct vert),
-                                  (GLvoid *) offsetof (struct vert, c));
-    }
-    if (u)
+/* Uniform scale followed by translation. */
+
+struct xform
+{
+    GLfloat k;
+    GLfloat x;
+    GLfloat y;
+};
+
+static struct batch_vert *batch_vert = NULL;
+static struct batch_vert *batch_sort = NULL;
+static int                batch_len  = 0;
+static int                batch_max  = 0;
+
+static struct batch_run  *batch_run  = NULL;
+static int                batch_runc = 0;
+static int                batch_runm = 0;
+
+static GLuint             batch_vbo  = 0;
+
+static void xf_move(struct xform *m, GLfloat x, GLfloat y)
+{
+    m->x += m->k * x;
+    m->y += m->k * y;
+}
+
+static void xf_scale(struct xform *m, GLfloat k)
+{
+    m->k *= k;
+}
+
+/*
+ * Reserve N vertices in the batch, extending the last run if it shares
+ * the given layer and texture.
+ */
+static struct batch_vert *batch_add(int layer, GLuint tex, int n)
+{
+    struct batch_run *r;
+
+    if (batch_len + n > batch_max)
     {
-        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        glTexCoordPointer(2, GL_FLOAT,         sizeof (struct vert),
-                                  (GLvoid *) offsetof (struct vert, u));
+        int m = batch_max ? batch_max : 1024;
+
+        struct batch_vert *v;
+        struct batch_vert *w;
+
+        while (m < batch_len + n)
+            m *= 2;
+
+        if (!(v = realloc(batch_vert, m * sizeof (*v))))
+            return NULL;
+
+        batch_vert = v;
+
+        if (!(w = realloc(batch_sort, m * sizeof (*w))))
+            return NULL;
+
+        batch_sort = w;
+        batch_max  = m;
     }
-    if (p)
+
+    r = batch_runc ? batch_run + batch_runc - 1 : NULL;
+
+    if (!r || r->layer != layer || r->tex != tex)
     {
-        glEnableClientState(GL_VERTEX_ARRAY);
-        glVertexPointer  (2, GL_SHORT,         sizeof (struct vert),
-                                  (GLvoid *) offsetof (struct vert, p));
+        if (batch_runc == batch_runm)
+        {
+            int m = batch_runm ? batch_runm * 2 : 64;
+
+            if (!(r = realloc(batch_run, m * sizeof (*r))))
+                return NULL;
+
+            batch_run  = r;
+            batch_runm = m;
+        }
+
+        r = batch_run + batch_runc;
+
+        r->layer = layer;
+        r->tex   = tex;
+        r->seq   = batch_runc;
+        r->off   = batch_len;
+        r->n     = 0;
+
+        batch_runc++;
     }
+
+    r->n      += n;
+    batch_len += n;
+
+    return batch_vert + batch_len - n;
+}
+
+static void batch_put(struct batch_vert *d, const struct xform *m,
+                      const struct vert *s)
+{
+    d->c[0] = s->c[0];
+    d->c[1] = s->c[1];
+    d->c[2] = s->c[2];
+    d->c[3] = s->c[3];
+    d->u[0] = s->u[0];
+    d->u[1] = s->u[1];
+    d->p[0] = m->k * s->p[0] + m->x;
+    d->p[1] = m->k * s->p[1] + m->y;
 }
 
-static void draw_rect(int id)
+static void batch_tris(int layer, GLuint tex, const struct xform *m,
+                       const struct vert *v, int n)
 {
-    glDrawElements(GL_TRIANGLE_STRIP, RECT_ELEM, GL_UNSIGNED_SHORT,
-                   (const GLvoid *) (id * WIDGET_ELEM * sizeof (GLushort)));
+    struct batch_vert *d;
+    int i;
+
+    if (n > 0 && (d = batch_add(layer, tex, n)))
+        for (i = 0; i < n; i++)
+            batch_put(d + i, m, v + i);
 }
 
-static void draw_text(int id)
+/*
+ * Add a grid of R by C vertices, column by column, as triangles.
+ */
+static void batch_grid(int layer, GLuint tex, const struct xform *m,
+                       const struct vert *v, int r, int c)
 {
-    glDrawArrays(GL_TRIANGLE_STRIP, id * WIDGET_VERT + RECT_VERT, TEXT_VERT);
+    struct batch_vert *d;
+    int i, j;
+
+    if ((d = batch_add(layer, tex, (r - 1) * (c - 1) * 6)))
+        for (i = 0; i < c - 1; i++)
+            for (j = 0; j < r - 1; j++)
+            {
+                const struct vert *a = v + (i    ) * r + j;
+                const struct vert *b = v + (i + 1) * r + j;
+
+                batch_put(d++, m, a);
+                batch_put(d++, m, a + 1);
+                batch_put(d++, m, b);
+                batch_put(d++, m, b);
+                batch_put(d++, m, a + 1);
+                batch_put(d++, m, b + 1);
+            }
 }
 
-static void draw_image(int id)
+static int batch_cmp(const void *p, const void *q)
 {
-    glDrawArrays(GL_TRIANGLE_STRIP, id * WIDGET_VERT + RECT_VERT, IMAGE_VERT);
+    const struct batch_run *a = (const struct batch_run *) p;
+    const struct batch_run *b = (const struct batch_run *) q;
+
+    if (a->layer != b->layer) return a->layer - b->layer;
+    if (a->tex   != b->tex)   return (a->tex < b->tex) ? -1 : +1;
+
+    return a->seq - b->seq;
 }
 
-static void draw_disable(void)
+/*
+ * Draw and empty the batch.
+ */
+static void batch_draw(void)
 {
-    glBindBuffer_(GL_ARRAY_BUFFER,         0);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    int i, j, n = 0, c = 0;
+
+    if (batch_len == 0)
+        return;
+
+    /* Lay the runs out in order, merging those that share a texture. */
+
+    qsort(batch_run, batch_runc, sizeof (*batch_run), batch_cmp);
+
+    for (i = 0; i < batch_runc; i++)
+    {
+        memcpy(batch_sort + n, batch_vert + batch_run[i].off,
+               batch_run[i].n * sizeof (*batch_sort));
+
+        batch_run[i].off = n;
+        n += batch_run[i].n;
+    }
+
+    for (i = 1, j = 0; i < batch_runc; i++)
+        if (batch_run[i].layer == batch_run[j].layer &&
+            batch_run[i].tex   == batch_run[j].tex)
+            batch_run[j].n += batch_run[i].n;
+        else
+            batch_run[++j] = batch_run[i];
+
+    batch_runc = j + 1;
+
+    /* Stream the vertices and draw each run. */
+
+    glBindBuffer_(GL_ARRAY_BUFFER, batch_vbo);
+    glBufferData_(GL_ARRAY_BUFFER, n * sizeof (*batch_sort), batch_sort,
+                  GL_STREAM_DRAW);
+
+    glEnableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_VERTEX_ARRAY);
+
+    glColorPointer   (4, GL_UNSIGNED_BYTE, sizeof (struct batch_vert),
+                      (GLvoid *) offsetof (struct batch_vert, c));
+    glTexCoordPointer(2, GL_FLOAT,         sizeof (struct batch_vert),
+                      (GLvoid *) offsetof (struct batch_vert, u));
+    glVertexPointer  (2, GL_FLOAT,         sizeof (struct batch_vert),
+                      (GLvoid *) offsetof (struct batch_vert, p));
+
+    for (i = 0; i < batch_runc; i++, c++)
+    {
+        glBindTexture(GL_TEXTURE_2D, batch_run[i].tex);
+        glDrawArrays(GL_TRIANGLES, batch_run[i].off, batch_run[i].n);
+    }
 
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
+
+    glBindBuffer_(GL_ARRAY_BUFFER, 0);
+
+#if ENABLE_GLSTAT
+    glstat_gui(c);
+#endif
+
+    batch_len  = 0;
+    batch_runc = 0;
 }
 
 /*---------------------------------------------------------------------------*/
 
 /*
  * Generate vertices for a 3x3 rectangle. Vertices are arranged
- * top-to-bottom and left-to-right, triangle strips are arranged
- * left-to-right and top-to-bottom (one strip per row). Degenerate
- * triangles (two extra indices per stitch) are inserted for a
- * continous strip.
+ * top-to-bottom and left-to-right.
  */
 
-static const GLushort rect_elem_base[RECT_ELEM] = {
-    0, 1, 4, 5, 8, 9, 12, 13, 13, 1,    /* Top    */
-    1, 2, 5, 6, 9, 10, 13, 14, 14, 2,   /* Middle */
-    2, 3, 6, 7, 10, 11, 14, 15          /* Bottom */
-};
-
 static void gui_geom_rect(int id, int x, int y, int w, int h, int f)
 {
-    GLushort rect_elem[RECT_ELEM];
-
-    struct vert *v = vert_buf + id * WIDGET_VERT;
-    struct vert *p = v;
+    struct vert *p = vert_buf + id * WIDGET_VERT;
 
     int X[4];
     int Y[4];
 
     int i, j;
 
-    /* Generate vertex and element data for the widget's rectangle. */
+    /* Generate vertex data for the widget's rectangle. */
 
     X[0] = x;
     X[1] = x +     ((f & GUI_W) ? borders[0] : 0);
@@ -275,71 +486,145 @@ static void gui_geom_rect(int id, int x, int y, int w, int h, int f)
     for (i = 0; i < 4; i++)
         for (j = 0; j < 4; j++)
             set_vert(p++, X[i], Y[j], curr_theme.s[i], curr_theme.t[j], gui_wht);
+}
+
+/*
+ * Make room in the glyph pool for N vertices of the given widget.
+ */
+static int gui_text_alloc(int id, int n)
+{
+    if (n <= widget[id].text_cap)
+        return 1;
+
+    widget[id].text_cap = 0;
+
+    if (text_len + n > text_max)
+    {
+        struct vert *v;
+
+        int m = text_max, c = 0, jd;
+
+        /* Pack the live ranges into a new pool, growing it as needed. */
+
+        for (jd = 1; jd < widget_max; jd++)
+            c += widget[jd].text_cap;
+
+        while (m < c + n)
+            m = m ? m * 2 : 4096;
+
+        if (!(v = (struct vert *) malloc(m * sizeof (*v))))
+            return 0;
+
+        for (c = 0, jd = 1; jd < widget_max; jd++)
+            if (widget[jd].text_cap)
+            {
+                memcpy(v + c, text_buf + widget[jd].text_off,
+                       widget[jd].text_cap * sizeof (*v));
+
+                widget[jd].text_off = c;
+                c += widget[jd].text_cap;
+            }
+
+        free(text_buf);
 
-    for (i = 0; i < RECT_ELEM; i++)
-        rect_elem[i] = id * WIDGET_VERT + rect_elem_base[i];
+        text_buf = v;
+        text_len = c;
+        text_max = m;
+    }
 
-    /* Copy this off to the VBOs. */
+    widget[id].text_off = text_len;
+    widget[id].text_cap = n;
 
-    glBindBuffer_   (GL_ARRAY_BUFFER, vert_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER,
-                     id * WIDGET_VERT * sizeof (struct vert),
-                            RECT_VERT * sizeof (struct vert), v);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
+    text_len += n;
 
-    glBindBuffer_   (GL_ELEMENT_ARRAY_BUFFER, vert_ebo);
-    glBufferSubData_(GL_ELEMENT_ARRAY_BUFFER,
-                     id * WIDGET_ELEM * sizeof (GLushort),
-                            RECT_ELEM * sizeof (GLushort), rect_elem);
-    glBindBuffer_   (GL_ELEMENT_ARRAY_BUFFER, 0);
+    return 1;
 }
 
-static void gui_geom_text(int id, int x, int y, int w, int h,
-                          const GLubyte *c0, const GLubyte *c1)
+/*
+ * Color the widget's glyph quads, with shadows first and text graded
+ * from C0 at the bottom to C1 at the top.
+ */
+static void gui_text_color(int id)
 {
-    struct vert *v = vert_buf + id * WIDGET_VERT + RECT_VERT;
+    struct vert *v = text_buf + widget[id].text_off;
 
-    /* Assume the applied texture size is rect size rounded to power-of-two. */
+    const int n = widget[id].text_cnt;
 
-    int W;
-    int H;
-
-    image_size(&W, &H, w, h);
+    int i;
 
-    if (w > 0 && h > 0 && W > 0 && H > 0)
+    for (i = 0; i < n; i++)
     {
-        const int d = h / 16;  /* Shadow offset */
+        const GLubyte *c;
+
+        if (i < n / 2)
+            c = gui_shd;
+        else if (i % 6 == 0 || i % 6 == 2 || i % 6 == 3)
+            c = widget[id].color1;
+        else
+            c = widget[id].color0;
+
+        v[i].c[0] = c[0];
+        v[i].c[1] = c[1];
+        v[i].c[2] = c[2];
+        v[i].c[3] = c[3];
+    }
+}
+
+static void set_quad(struct vert *v, int x, int y, const struct font_quad *q)
+{
+    set_vert(v + 0, x,        y + q->h, q->s0, q->t0, gui_wht);
+    set_vert(v + 1, x,        y,        q->s0, q->t1, gui_wht);
+    set_vert(v + 2, x + q->w, y + q->h, q->s1, q->t0, gui_wht);
+    set_vert(v + 3, x + q->w, y + q->h, q->s1, q->t0, gui_wht);
+    set_vert(v + 4, x,        y,        q->s0, q->t1, gui_wht);
+    set_vert(v + 5, x + q->w, y,        q->s1, q->t1, gui_wht);
+}
 
-        const int ww = ((W - w) % 2) ? w + 1 : w;
-        const int hh = ((H - h) % 2) ? h + 1 : h;
+/*
+ * Lay out the given text from the font atlas as the widget's glyph
+ * quads, centered on the widget, and note the atlas page and extent.
+ */
+static void gui_text_set(int id, const char *text)
+{
+    struct font      *ft = &fonts[widget[id].font];
+    struct font_quad *qv;
 
-        const GLfloat s0 = 0.5f * (W - ww) / W;
-        const GLfloat t0 = 0.5f * (H - hh) / H;
-        const GLfloat s1 = 1.0f - s0;
-        const GLfloat t1 = 1.0f - t0;
+    GLuint page = 0;
 
-        /* Generate vertex data for the colored text and its shadow. */
+    int w = 0;
+    int h = 0;
+    int n = 0;
+    int i;
 
-        set_vert(v + 0, x      + d, y + hh - d, s0, t0, gui_shd);
-        set_vert(v + 1, x      + d, y      - d, s0, t1, gui_shd);
-        set_vert(v + 2, x + ww + d, y + hh - d, s1, t0, gui_shd);
-        set_vert(v + 3, x + ww + d, y      - d, s1, t1, gui_shd);
+    if (text && (qv = malloc((strlen(text) + 1) * sizeof (*qv))))
+    {
+        n = font_layout(ft, widget[id].size, text, qv, &page, &w, &h);
 
-        set_vert(v + 4, x,          y + hh,     s0, t0, c1);
-        set_vert(v + 5, x,          y,          s0, t1, c0);
-        set_vert(v + 6, x + ww,     y + hh,     s1, t0, c1);
-        set_vert(v + 7, x + ww,     y,          s1, t1, c0);
+        if (n && gui_text_alloc(id, n * GLYPH_VERT))
+        {
+            struct vert *v = text_buf + widget[id].text_off;
 
+            const int x = -w / 2;
+            const int y = -h / 2;
+            const int d =  h / 16;  /* Shadow offset */
+
+            for (i = 0; i < n; i++)
+            {
+                set_quad(v + 6 *  i,      x + qv[i].x + d, y - d, qv + i);
+                set_quad(v + 6 * (i + n), x + qv[i].x,     y,     qv + i);
+            }
+        }
+        else n = 0;
+
+        free(qv);
     }
-    else memset(v, 0, TEXT_VERT * sizeof (struct vert));
 
-    /* Copy this off to the VBO. */
+    widget[id].image    = n ? page : 0;
+    widget[id].text_w   = w;
+    widget[id].text_h   = h;
+    widget[id].text_cnt = n * GLYPH_VERT;
 
-    glBindBuffer_   (GL_ARRAY_BUFFER, vert_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER,
-                     (id * WIDGET_VERT + RECT_VERT) * sizeof (struct vert),
-                                         TEXT_VERT  * sizeof (struct vert), v);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
+    gui_text_color(id);
 }
 
 static void gui_geom_image(int id, int x, int y, int w, int h, int f)
@@ -357,75 +642,32 @@ static void gui_geom_image(int id, int x, int y, int w, int h, int f)
     Y[0] = y + h - ((f & GUI_N) ? borders[2] : 0);
     Y[1] = y +     ((f & GUI_S) ? borders[3] : 0);
 
-    set_vert(v + 0, X[0], Y[0], 0.0f, 1.0f, gui_wht);
-    set_vert(v + 1, X[0], Y[1], 0.0f, 0.0f, gui_wht);
-    set_vert(v + 2, X[1], Y[0], 1.0f, 1.0f, gui_wht);
-    set_vert(v + 3, X[1], Y[1], 1.0f, 0.0f, gui_wht);
-
-    /* Copy this off to the VBO. */
-
-    glBindBuffer_   (GL_ARRAY_BUFFER, vert_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER,
-                     (id * WIDGET_VERT + RECT_VERT) * sizeof (struct vert),
-                     IMAGE_VERT * sizeof (struct vert), v);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
+    set_vert(v + 0, X[0], Y[0], widget[id].uv[0], widget[id].uv[3], gui_wht);
+    set_vert(v + 1, X[0], Y[1], widget[id].uv[0], widget[id].uv[1], gui_wht);
+    set_vert(v + 2, X[1], Y[0], widget[id].uv[2], widget[id].uv[3], gui_wht);
+    set_vert(v + 3, X[1], Y[1], widget[id].uv[2], widget[id].uv[1], gui_wht);
 }
 
-static void gui_geom_widget(int id, int flags)
+/*
+ * Generate the widget's geometry for its current size.  A rectangle is
+ * generated for any widget that wants one, whether or not an enclosing
+ * rectangle hides it.
+ */
+static void gui_geom_widget(int id)
 {
-    int jd;
-
     int w = widget[id].w;
     int h = widget[id].h;
-
-    int W = widget[id].text_w;
-    int H = widget[id].text_h;
     int R = widget[id].rect;
 
-    const GLubyte *c0 = widget[id].color0;
-    const GLubyte *c1 = widget[id].color1;
-
-    if ((widget[id].flags & GUI_RECT) && !(flags & GUI_RECT))
-    {
+    if (widget[id].flags & GUI_RECT)
         gui_geom_rect(id, -w / 2, -h / 2, w, h, R);
-        flags |= GUI_RECT;
-    }
-
-    switch (widget[id].type)
-    {
-    case GUI_FILLER:
-    case GUI_SPACE:
-        break;
 
-    case GUI_HARRAY:
-    case GUI_VARRAY:
-    case GUI_HSTACK:
-    case GUI_VSTACK:
-
-        for (jd = widget[id].car; jd; jd = widget[jd].cdr)
-            gui_geom_widget(jd, flags);
-
-        break;
-
-    case GUI_IMAGE:
+    if (widget[id].type == GUI_IMAGE)
         gui_geom_image(id, -w / 2, -h / 2, w, h, R);
-        break;
-
-    default:
-        gui_geom_text(id, -W / 2, -H / 2, W, H, c0, c1);
-        break;
-    }
 }
 
 /*---------------------------------------------------------------------------*/
 
-#define FONT_MAX 4
-
-static struct font fonts[FONT_MAX];
-static int         fontc;
-
-static int font_sizes[3];
-
 static int gui_font_load(const char *path)
 {
     int i;
@@ -506,8 +748,6 @@ void gui_init(void)
 
     int i, j;
 
-    memset(widget, 0, sizeof (struct widget) * WIDGET_MAX);
-
     /* Compute default widget/text padding. */
 
     padding = s / 60;
@@ -523,21 +763,9 @@ void gui_init(void)
 
     gui_theme_init();
 
-    /* Initialize the VBOs. */
+    /* Initialize the batch VBO. */
 
-    memset(vert_buf, 0, sizeof (vert_buf));
-
-    glGenBuffers_(1,              &vert_vbo);
-    glBindBuffer_(GL_ARRAY_BUFFER, vert_vbo);
-    glBufferData_(GL_ARRAY_BUFFER, sizeof (vert_buf), vert_buf, GL_STATIC_DRAW);
-    glBindBuffer_(GL_ARRAY_BUFFER, 0);
-
-    glGenBuffers_(1,                      &vert_ebo);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, vert_ebo);
-    glBufferData_(GL_ELEMENT_ARRAY_BUFFER,
-                  WIDGET_MAX * WIDGET_ELEM * sizeof (GLushort),
-                  NULL, GL_STATIC_DRAW);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glGenBuffers_(1, &batch_vbo);
 
     /* Cache digit glyphs for HUD rendering. */
 
@@ -573,24 +801,46 @@ void gui_free(void)
 {
     int id;
 
-    /* Release the VBOs. */
+    /* Release the batch. */
 
-    glDeleteBuffers_(1, &vert_vbo);
-    glDeleteBuffers_(1, &vert_ebo);
+    glDeleteBuffers_(1, &batch_vbo);
 
-    /* Release any remaining widget texture and display list indices. */
+    free(batch_vert);
+    free(batch_sort);
+    free(batch_run);
 
-    for (id = 1; id < WIDGET_MAX; id++)
-    {
-        if (widget[id].image)
+    batch_vert = NULL;
+    batch_sort = NULL;
+    batch_run  = NULL;
+    batch_max  = 0;
+    batch_runm = 0;
+
+    /* Release any remaining widget textures, and the widget pool. */
+
+    for (id = 1; id < widget_max; id++)
+        if (widget[id].type == GUI_IMAGE && widget[id].image &&
+            !(widget[id].flags & GUI_THUMB))
             glDeleteTextures(1, &widget[id].image);
 
-        widget[id].type  = GUI_FREE;
-        widget[id].flags = 0;
-        widget[id].image = 0;
-        widget[id].cdr   = 0;
-        widget[id].car   = 0;
-    }
+    free(widget);
+    free(vert_buf);
+
+    widget      = NULL;
+    vert_buf    = NULL;
+    widget_max  = 0;
+    widget_free = 0;
+
+    /* Release the thumbnail atlas. */
+
+    thumb_quit();
+
+    /* Release the glyph quad pool. */
+
+    free(text_buf);
+
+    text_buf = NULL;
+    text_len = 0;
+    text_max = 0;
 
     /* Release all loaded fonts and finalize font rendering. */
 
@@ -603,54 +853,119 @@ void gui_free(void)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Grow the widget pool, threading the new entries onto the free list.
+ * Entry zero is never used, so that zero may mean "no widget".
+ */
+static int gui_grow(void)
+{
+    int m = widget_max ? widget_max * 2 : WIDGET_INIT;
+    int id;
+
+    struct widget *w;
+    struct vert   *v;
+
+    if (!(w = realloc(widget, m * sizeof (*w))))
+        return 0;
+
+    widget = w;
+
+    if (!(v = realloc(vert_buf, m * WIDGET_VERT * sizeof (*v))))
+        return 0;
+
+    vert_buf = v;
+
+    memset(widget + widget_max, 0, (m - widget_max) * sizeof (*w));
+
+    for (id = m - 1; id >= widget_max && id > 0; id--)
+    {
+        widget[id].cdr = widget_free;
+        widget_free = id;
+    }
+
+    widget_max = m;
+
+    return 1;
+}
+
+/*
+ * Mark a widget and its ancestors as needing the given layout passes.
+ * A widget that is already marked has marked ancestors.
+ */
+static void gui_dirty(int id, int f)
+{
+    for (; id && (widget[id].flags & f) != f; id = widget[id].par)
+        widget[id].flags |= f;
+}
+
 static int gui_widget(int pd, int type)
 {
     int id;
 
-    /* Find an unused entry in the widget table. */
+    /* Take an unused entry from the free list. */
 
-    for (id = 1; id < WIDGET_MAX; id++)
-        if (widget[id].type == GUI_FREE)
-        {
-            /* Set the type and default properties. */
-
-            widget[id].type   = type;
-            widget[id].flags  = 0;
-            widget[id].token  = 0;
-            widget[id].value  = 0;
-            widget[id].font   = 0;
-            widget[id].size   = 0;
-            widget[id].rect   = GUI_ALL;
-            widget[id].w      = 0;
-            widget[id].h      = 0;
-            widget[id].image  = 0;
-            widget[id].color0 = gui_wht;
-            widget[id].color1 = gui_wht;
-            widget[id].scale  = 1.0f;
-            widget[id].trunc  = TRUNC_NONE;
-            widget[id].text_w = 0;
-            widget[id].text_h = 0;
-
-            /* Insert the new widget into the parent's widget list. */
-
-            if (pd)
-            {
-                widget[id].car = 0;
-                widget[id].cdr = widget[pd].car;
-                widget[pd].car = id;
-            }
-            else
-            {
-                widget[id].car = 0;
-                widget[id].cdr = 0;
-            }
+    if (!widget_free && !gui_grow())
+    {
+        log_printf("Out of widget IDs\n");
+        return 0;
+    }
 
-            return id;
-        }
+    id = widget_free;
+
+    widget_free = widget[id].cdr;
+
+    /* Set the type and default properties. */
+
+    widget[id].type   = type;
+    widget[id].flags  = 0;
+    widget[id].token  = 0;
+    widget[id].value  = 0;
+    widget[id].font   = 0;
+    widget[id].size   = 0;
+    widget[id].rect   = GUI_ALL;
+    widget[id].x      = 0;
+    widget[id].y      = 0;
+    widget[id].w      = 0;
+    widget[id].h      = 0;
+    widget[id].nw     = 0;
+    widget[id].nh     = 0;
+    widget[id].image  = 0;
+    widget[id].color0 = gui_wht;
+    widget[id].color1 = gui_wht;
+    widget[id].scale  = 1.0f;
+    widget[id].uv[0]  = 0.0f;
+    widget[id].uv[1]  = 0.0f;
+    widget[id].uv[2]  = 1.0f;
+    widget[id].uv[3]  = 1.0f;
+    widget[id].trunc  = TRUNC_NONE;
+    widget[id].text_w = 0;
+    widget[id].text_h = 0;
+
+    widget[id].text_off = 0;
+    widget[id].text_cnt = 0;
+    widget[id].text_cap = 0;
+
+    /* Insert the new widget into the parent's widget list. */
+
+    if (pd)
+    {
+        widget[id].par = pd;
+        widget[id].car = 0;
+        widget[id].cdr = widget[pd].car;
+        widget[pd].car = id;
+    }
+    else
+    {
+        widget[id].par = 0;
+        widget[id].car = 0;
+        widget[id].cdr = 0;
+    }
 
-    log_printf("Out of widget IDs\n");
+    /* The new widget, and everything above it, must be laid out. */
 
-    return 0;
+    gui_dirty(id, GUI_DIRTY | GUI_MOVED);
+
+    return id;
 }
 
 int gui_harray(int pd) { return gui_widget(pd, GUI_HARRAY); }
@@ -661,98 +976,74 @@ int gui_filler(int pd) { return gui_widget(pd, GUI_FILLER); }
 
 /*---------------------------------------------------------------------------*/
 
-static struct size gui_measure_ttf(const char *text, TTF_Font *font)
+struct size gui_measure(const char *text, int size)
 {
-    struct size size = { 0, 0 };
+    struct size sz;
 
-    if (font)
-        TTF_SizeUTF8(font, text, &size.w, &size.h);
+    sz.w = font_width (&fonts[0], size, text);
+    sz.h = font_height(&fonts[0], size);
 
-    return size;
-}
-
-struct size gui_measure(const char *text, int size)
-{
-    return gui_measure_ttf(text, fonts[0].ttf[size]);
+    return sz;
 }
 
 /*---------------------------------------------------------------------------*/
 
 static char *gui_trunc_head(const char *text,
                             const int maxwidth,
-                            TTF_Font *font)
+                            struct font *ft, int size)
 {
-    int left, right, mid;
-    char *str = NULL;
-
-    left  = 0;
-    right = strlen(text);
+    const int e = font_width(ft, size, "...");
 
-    while (right - left > 1)
-    {
-        mid = (left + right) / 2;
+    const char *p = text;
 
-        str = concat_string("...", text + mid, NULL);
+    int w = font_width(ft, size, text);
 
-        if (gui_measure_ttf(str, font).w <= maxwidth)
-            right = mid;
-        else
-            left = mid;
+    /* Drop leading characters until the rest fits after an ellipsis. */
 
-        free(str);
-    }
+    while (*p && w + e > maxwidth)
+        w -= font_advance(ft, size, &p);
 
-    return concat_string("...", text + right, NULL);
+    return concat_string("...", p, NULL);
 }
 
 static char *gui_trunc_tail(const char *text,
                             const int maxwidth,
-                            TTF_Font *font)
+                            struct font *ft, int size)
 {
-    int left, right, mid;
-    char *str = NULL;
+    const int e = font_width(ft, size, "...");
 
-    left  = 0;
-    right = strlen(text);
+    const char *p = text;
+    const char *q = text;
 
-    while (right - left > 1)
-    {
-        mid = (left + right) / 2;
-
-        str = malloc(mid + sizeof ("..."));
+    char *str;
+    int w = 0;
 
-        memcpy(str,       text,  mid);
-        memcpy(str + mid, "...", sizeof ("..."));
+    /* Keep leading characters while they fit before an ellipsis. */
 
-        if (gui_measure_ttf(str, font).w <= maxwidth)
-            left = mid;
-        else
-            right = mid;
+    while (*q && (w += font_advance(ft, size, &q)) + e <= maxwidth)
+        p = q;
 
-        free(str);
+    if ((str = malloc((p - text) + sizeof ("..."))))
+    {
+        memcpy(str,              text,  p - text);
+        memcpy(str + (p - text), "...", sizeof ("..."));
     }
-
-    str = malloc(left + sizeof ("..."));
-
-    memcpy(str,        text,  left);
-    memcpy(str + left, "...", sizeof ("..."));
-
     return str;
 }
 
 static char *gui_truncate(const char *text,
                           const int maxwidth,
-                          TTF_Font *font,
+                          struct font *ft, int size,
                           enum trunc trunc)
 {
-    if (gui_measure_ttf(text, font).w <= maxwidth)
+    if (font_width(ft, size, text) <= maxwidth)
         return strdup(text);
 
     switch (trunc)
     {
-    case TRUNC_NONE: return strdup(text);                         break;
-    case TRUNC_HEAD: return gui_trunc_head(text, maxwidth, font); break;
-    case TRUNC_TAIL: return gui_trunc_tail(text, maxwidth, font); break;
+    case TRUNC_NONE: return strdup(text);                             break;
+    case TRUNC_HEAD: return gui_trunc_head(text, maxwidth, ft, size); break;
+    case TRUNC_TAIL: return gui_trunc_tail(text, maxwidth, ft, size); break;
     }
 
     return NULL;
@@ -760,38 +1051,65 @@ static char *gui_truncate(const char *text,
 
 /*---------------------------------------------------------------------------*/
 
-void gui_set_image(int id, const char *file)
+/*
+ * Set the texture coordinates of an image widget, and update its
+ * geometry to match.
+ */
+static void gui_set_uv(int id, GLfloat s0, GLfloat t0, GLfloat s1, GLfloat t1)
 {
-    glDeleteTextures(1, &widget[id].image);
+    widget[id].uv[0] = s0;
+    widget[id].uv[1] = t0;
+    widget[id].uv[2] = s1;
+    widget[id].uv[3] = t1;
 
-    widget[id].image = make_image_from_file(file, IF_MIPMAP);
+    gui_geom_widget(id);
 }
 
-void gui_set_label(int id, const char *text)
+void gui_set_image(int id, const char *file)
 {
-    TTF_Font *ttf = fonts[widget[id].font].ttf[widget[id].size];
+    if (!(widget[id].flags & GUI_THUMB))
+        glDeleteTextures(1, &widget[id].image);
 
-    int w = 0;
-    int h = 0;
+    widget[id].image  = make_image_from_file(file, IF_MIPMAP);
+    widget[id].flags &= ~GUI_THUMB;
 
-    char *str;
+    gui_set_uv(id, 0.0f, 0.0f, 1.0f, 1.0f);
+}
 
-    glDeleteTextures(1, &widget[id].image);
+/*
+ * Show a thumbnail of the named image, from the shared atlas.  Paging
+ * through screenshots reuses thumbnails already loaded.
+ */
+void gui_set_thumb(int id, const char *file)
+{
+    GLfloat uv[4];
 
-    str = gui_truncate(text, widget[id].w - padding, ttf, widget[id].trunc);
+    if (!(widget[id].flags & GUI_THUMB))
+        glDeleteTextures(1, &widget[id].image);
 
-    widget[id].image = make_image_from_font(NULL, NULL,
-                                            &widget[id].text_w,
-                                            &widget[id].text_h,
-                                            str, ttf, 0);
-    w = widget[id].text_w;
-    h = widget[id].text_h;
+    if ((widget[id].image = thumb_get(file, uv)))
+    {
+        widget[id].flags |= GUI_THUMB;
+        gui_set_uv(id, uv[0], uv[1], uv[2], uv[3]);
+    }
+    else
+    {
+        widget[id].flags &= ~GUI_THUMB;
+        gui_set_uv(id, 0.0f, 0.0f, 1.0f, 1.0f);
+    }
+}
 
-    gui_geom_text(id, -w / 2, -h / 2, w, h,
-                  widget[id].color0,
-                  widget[id].color1);
+void gui_set_label(int id, const char *text)
+{
+    char *str;
 
-    free(str);
+    if ((str = gui_truncate(text, widget[id].w - padding,
+                            &fonts[widget[id].font], widget[id].size,
+                            widget[id].trunc)))
+    {
+        gui_text_set(id, str);
+        free(str);
+    }
 }
 
 void gui_set_count(int id, int value)
@@ -814,13 +1132,10 @@ void gui_set_color(int id, const GLubyte *c0,
 
         if (widget[id].color0 != c0 || widget[id].color1 != c1)
         {
-            int w = widget[id].text_w;
-            int h = widget[id].text_h;
-
             widget[id].color0 = c0;
             widget[id].color1 = c1;
 
-            gui_geom_text(id, -w / 2, -h / 2, w, h, c0, c1);
+            gui_text_color(id);
         }
     }
 }
@@ -867,6 +1182,8 @@ void gui_set_font(int id, const char *path)
 void gui_set_fill(int id)
 {
     widget[id].flags |= GUI_FILL;
+
+    gui_dirty(widget[id].par, GUI_MOVED);
 }
 
 /*
@@ -895,6 +1212,8 @@ void gui_set_rect(int id, int rect)
 {
     widget[id].rect   = rect;
     widget[id].flags |= GUI_RECT;
+
+    gui_dirty(id, GUI_MOVED);
 }
 
 void gui_set_cursor(int st)
@@ -918,6 +1237,21 @@ int gui_image(int pd, const char *file, int w, int h)
     return id;
 }
 
+int gui_thumb(int pd, const char *file, int w, int h)
+{
+    int id;
+
+    if ((id = gui_widget(pd, GUI_IMAGE)))
+    {
+        widget[id].w      = w;
+        widget[id].h      = h;
+        widget[id].flags |= GUI_RECT;
+
+        gui_set_thumb(id, file);
+    }
+    return id;
+}
+
 int gui_start(int pd, const char *text, int size, int token, int value)
 {
     int id;
@@ -934,19 +1268,16 @@ int gui_state(int pd, const char *text, int size, int token, int value)
 
     if ((id = gui_widget(pd, GUI_BUTTON)))
     {
-        TTF_Font *ttf = fonts[widget[id].font].ttf[size];
-
         widget[id].flags |= (GUI_STATE | GUI_RECT);
 
-        widget[id].image = make_image_from_font(NULL, NULL,
-                                                &widget[id].text_w,
-                                                &widget[id].text_h,
-                                                text, ttf, 0);
-        widget[id].w     = widget[id].text_w;
-        widget[id].h     = widget[id].text_h;
         widget[id].size  = size;
         widget[id].token = token;
         widget[id].value = value;
+
+        gui_text_set(id, text);
+
+        widget[id].w     = widget[id].text_w;
+        widget[id].h     = widget[id].text_h;
     }
     return id;
 }
@@ -958,18 +1289,15 @@ int gui_label(int pd, const char *text, int size, const GLubyte *c0,
 
     if ((id = gui_widget(pd, GUI_LABEL)))
     {
-        TTF_Font *ttf = fonts[widget[id].font].ttf[size];
-
-        widget[id].image = make_image_from_font(NULL, NULL,
-                                                &widget[id].text_w,
-                                                &widget[id].text_h,
-                                                text, ttf, 0);
-        widget[id].w      = widget[id].text_w;
-        widget[id].h      = widget[id].text_h;
         widget[id].size   = size;
         widget[id].color0 = c0 ? c0 : gui_yel;
         widget[id].color1 = c1 ? c1 : gui_red;
         widget[id].flags |= GUI_RECT;
+
+        gui_text_set(id, text);
+
+        widget[id].w      = widget[id].text_w;
+        widget[id].h      = widget[id].text_h;
     }
     return id;
 }
@@ -1071,7 +1399,8 @@ int gui_multi(int pd, const char *text, int size, const GLubyte *c0,
  * The bottom-up pass determines the area of all widgets.  The minimum
  * width  and height of  a leaf  widget is  given by  the size  of its
  * contents.   Array  and  stack   widths  and  heights  are  computed
- * recursively from these.
+ * recursively from these.  The result is kept as the natural size, and
+ * subtrees that have not changed since they were last measured keep it.
  */
 
 static void gui_widget_up(int id);
@@ -1086,10 +1415,10 @@ static void gui_harray_up(int id)
     {
         gui_widget_up(jd);
 
-        if (widget[id].h < widget[jd].h)
-            widget[id].h = widget[jd].h;
-        if (widget[id].w < widget[jd].w)
-            widget[id].w = widget[jd].w;
+        if (widget[id].h < widget[jd].nh)
+            widget[id].h = widget[jd].nh;
+        if (widget[id].w < widget[jd].nw)
+            widget[id].w = widget[jd].nw;
 
         c++;
     }
@@ -1109,10 +1438,10 @@ static void gui_varray_up(int id)
     {
         gui_widget_up(jd);
 
-        if (widget[id].h < widget[jd].h)
-            widget[id].h = widget[jd].h;
-        if (widget[id].w < widget[jd].w)
-            widget[id].w = widget[jd].w;
+        if (widget[id].h < widget[jd].nh)
+            widget[id].h = widget[jd].nh;
+        if (widget[id].w < widget[jd].nw)
+            widget[id].w = widget[jd].nw;
 
         c++;
     }
@@ -1132,10 +1461,10 @@ static void gui_hstack_up(int id)
     {
         gui_widget_up(jd);
 
-        if (widget[id].h < widget[jd].h)
-            widget[id].h = widget[jd].h;
+        if (widget[id].h < widget[jd].nh)
+            widget[id].h = widget[jd].nh;
 
-        widget[id].w += widget[jd].w;
+        widget[id].w += widget[jd].nw;
     }
 }
 
@@ -1149,10 +1478,10 @@ static void gui_vstack_up(int id)
     {
         gui_widget_up(jd);
 
-        if (widget[id].w < widget[jd].w)
-            widget[id].w = widget[jd].w;
+        if (widget[id].w < widget[jd].nw)
+            widget[id].w = widget[jd].nw;
 
-        widget[id].h += widget[jd].h;
+        widget[id].h += widget[jd].nh;
     }
 }
 
@@ -1178,7 +1507,19 @@ static void gui_button_up(int id)
 
 static void gui_widget_up(int id)
 {
-    if (id)
+    if (id && (widget[id].flags & GUI_DIRTY))
+    {
+        switch (widget[id].type)
+        {
+        case GUI_HARRAY:
+        case GUI_VARRAY:
+        case GUI_HSTACK:
+        case GUI_VSTACK:
+            widget[id].w = 0;
+            widget[id].h = 0;
+            break;
+        }
+
         switch (widget[id].type)
         {
         case GUI_HARRAY: gui_harray_up(id); break;
@@ -1188,13 +1529,19 @@ static void gui_widget_up(int id)
         case GUI_FILLER:                    break;
         default:         gui_button_up(id); break;
         }
+
+        widget[id].nw     = widget[id].w;
+        widget[id].nh     = widget[id].h;
+        widget[id].flags &= ~GUI_DIRTY;
+    }
 }
 
 /*---------------------------------------------------------------------------*/
 /*
  * The  top-down layout  pass distributes  available area  as computed
  * during the bottom-up pass.  Widgets  use their area and position to
- * initialize rendering state.
+ * initialize rendering state.  A subtree given the same area as before
+ * is skipped, unless something within it has changed.
  */
 
 static void gui_widget_dn(int id, int x, int y, int w, int h);
@@ -1266,10 +1613,10 @@ static void gui_hstack_dn(int id, int x, int y, int w, int h)
         else if (widget[jd].flags & GUI_FILL)
         {
             c  += 1;
-            jw += widget[jd].w;
+            jw += widget[jd].nw;
         }
         else
-            jw += widget[jd].w;
+            jw += widget[jd].nw;
 
     /* Give non-filler children their requested space.   */
     /* Distribute the rest evenly among filler children. */
@@ -1279,9 +1626,9 @@ static void gui_hstack_dn(int id, int x, int y, int w, int h)
         if (widget[jd].type == GUI_FILLER)
             gui_widget_dn(jd, jx, y, (w - jw) / c, h);
         else if (widget[jd].flags & GUI_FILL)
-            gui_widget_dn(jd, jx, y, widget[jd].w + (w - jw) / c, h);
+            gui_widget_dn(jd, jx, y, widget[jd].nw + (w - jw) / c, h);
         else
-            gui_widget_dn(jd, jx, y, widget[jd].w, h);
+            gui_widget_dn(jd, jx, y, widget[jd].nw, h);
 
         jx += widget[jd].w;
     }
@@ -1304,10 +1651,10 @@ static void gui_vstack_dn(int id, int x, int y, int w, int h)
         else if (widget[jd].flags & GUI_FILL)
         {
             c  += 1;
-            jh += widget[jd].h;
+            jh += widget[jd].nh;
         }
         else
-            jh += widget[jd].h;
+            jh += widget[jd].nh;
 
     /* Give non-filler children their requested space.   */
     /* Distribute the rest evenly among filler children. */
@@ -1317,9 +1664,9 @@ static void gui_vstack_dn(int id, int x, int y, int w, int h)
         if (widget[jd].type == GUI_FILLER)
             gui_widget_dn(jd, x, jy, w, (h - jh) / c);
         else if (widget[jd].flags & GUI_FILL)
-            gui_widget_dn(jd, x, jy, w, widget[jd].h + (h - jh) / c);
+            gui_widget_dn(jd, x, jy, w, widget[jd].nh + (h - jh) / c);
         else
-            gui_widget_dn(jd, x, jy, w, widget[jd].h);
+            gui_widget_dn(jd, x, jy, w, widget[jd].nh);
 
         jy += widget[jd].h;
     }
@@ -1346,6 +1693,16 @@ static void gui_button_dn(int id, int x, int y, int w, int h)
 static void gui_widget_dn(int id, int x, int y, int w, int h)
 {
     if (id)
+    {
+        /* Geometry is relative to the widget center, so only a new size */
+        /* or a change within the widget requires it to be regenerated.  */
+
+        const int moved = (widget[id].flags & GUI_MOVED) ||
+                          (widget[id].w != w || widget[id].h != h);
+
+        if (!moved && widget[id].x == x && widget[id].y == y)
+            return;
+
         switch (widget[id].type)
         {
         case GUI_HARRAY: gui_harray_dn(id, x, y, w, h); break;
@@ -1356,6 +1713,12 @@ static void gui_widget_dn(int id, int x, int y, int w, int h)
         case GUI_SPACE:  gui_filler_dn(id, x, y, w, h); break;
         default:         gui_button_dn(id, x, y, w, h); break;
         }
+
+        if (moved)
+            gui_geom_widget(id);
+
+        widget[id].flags &= ~GUI_MOVED;
+    }
 }
 
 /*---------------------------------------------------------------------------*/
@@ -1363,7 +1726,8 @@ static void gui_widget_dn(int id, int x, int y, int w, int h)
  * During GUI layout, we make a bottom-up pass to determine total area
  * requirements for  the widget  tree.  We position  this area  to the
  * sides or center of the screen.  Finally, we make a top-down pass to
- * distribute this area to each widget.
+ * distribute this area to each widget.  Laying out a tree again only
+ * revisits the widgets that have been added or changed since.
  */
 
 void gui_layout(int id, int xd, int yd)
@@ -1375,8 +1739,8 @@ void gui_layout(int id, int xd, int yd)
 
     gui_widget_up(id);
 
-    w = widget[id].w;
-    h = widget[id].h;
+    w = widget[id].nw;
+    h = widget[id].nh;
 
     if      (xd < 0) x = 0;
     else if (xd > 0) x = (W - w);
@@ -1388,10 +1752,6 @@ void gui_layout(int id, int xd, int yd)
 
     gui_widget_dn(id, x, y, w, h);
 
-    /* Set up GUI rendering state. */
-
-    gui_geom_widget(id, 0);
-
     /* Hilite the widget under the cursor, if any. */
 
     gui_point(id, -1, -1);
@@ -1425,18 +1785,25 @@ int gui_delete(int id)
         gui_delete(widget[id].cdr);
         gui_delete(widget[id].car);
 
-        /* Release any GL resources held by this widget. */
+        /* Release any GL resources held by this widget.  Text is drawn  */
+        /* from the font atlas, which does not belong to the widget.      */
 
-        if (widget[id].image)
+        if (widget[id].type == GUI_IMAGE && widget[id].image &&
+            !(widget[id].flags & GUI_THUMB))
             glDeleteTextures(1, &widget[id].image);
 
-        /* Mark this widget unused. */
+        /* Return this widget to the pool.  Its glyph quads are  */
+        /* reclaimed later.                                       */
+
+        widget[id].type     = GUI_FREE;
+        widget[id].flags    = 0;
+        widget[id].image    = 0;
+        widget[id].par      = 0;
+        widget[id].car      = 0;
+        widget[id].text_cap = 0;
 
-        widget[id].type  = GUI_FREE;
-        widget[id].flags = 0;
-        widget[id].image = 0;
-        widget[id].cdr   = 0;
-        widget[id].car   = 0;
+        widget[id].cdr = widget_free;
+        widget_free    = id;
 
         /* Clear focus from this widget. */
 
@@ -1461,15 +1828,13 @@ static void gui_paint_rect(int id, int st, int flags)
     {
         /* Draw a leaf's background, colored by widget state. */
 
-        glPushMatrix();
-        {
-            glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                         (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+        struct xform m = { 1.0f, 0.0f, 0.0f };
 
-            glBindTexture(GL_TEXTURE_2D, curr_theme.tex[i]);
-            draw_rect(id);
-        }
-        glPopMatrix();
+        xf_move(&m, (GLfloat) (widget[id].x + widget[id].w / 2),
+                    (GLfloat) (widget[id].y + widget[id].h / 2));
+
+        batch_grid(LAYER_RECT, curr_theme.tex[i], &m,
+                   vert_buf + id * WIDGET_VERT, 4, 4);
 
         flags |= GUI_RECT;
     }
@@ -1492,103 +1857,94 @@ static void gui_paint_rect(int id, int st, int flags)
 
 /*---------------------------------------------------------------------------*/
 
-static void gui_paint_text(int id);
+static void gui_paint_text(int id, const struct xform *);
+
+static void draw_text(int id, const struct xform *m)
+{
+    batch_tris(LAYER_TEXT, widget[id].image, m,
+               text_buf + widget[id].text_off, widget[id].text_cnt);
+}
 
-static void gui_paint_array(int id)
+static void gui_paint_array(int id, const struct xform *p)
 {
+    struct xform m = *p;
     int jd;
 
-    glPushMatrix();
-    {
-        GLfloat cx = widget[id].x + widget[id].w / 2.0f;
-        GLfloat cy = widget[id].y + widget[id].h / 2.0f;
-        GLfloat ck = widget[id].scale;
+    GLfloat cx = widget[id].x + widget[id].w / 2.0f;
+    GLfloat cy = widget[id].y + widget[id].h / 2.0f;
+    GLfloat ck = widget[id].scale;
 
-        if (1.0f < ck || ck < 1.0f)
-        {
-            glTranslatef(+cx, +cy, 0.0f);
-            glScalef(ck, ck, ck);
-            glTranslatef(-cx, -cy, 0.0f);
-        }
+    if (1.0f < ck || ck < 1.0f)
+    {
+        xf_move(&m, +cx, +cy);
+        xf_scale(&m, ck);
+        xf_move(&m, -cx, -cy);
+    }
 
-        /* Recursively paint all subwidgets. */
+    /* Recursively paint all subwidgets. */
 
-        for (jd = widget[id].car; jd; jd = widget[jd].cdr)
-            gui_paint_text(jd);
-    }
-    glPopMatrix();
+    for (jd = widget[id].car; jd; jd = widget[jd].cdr)
+        gui_paint_text(jd, &m);
 }
 
-static void gui_paint_image(int id)
+static void gui_paint_image(int id, int layer, const struct xform *p)
 {
-    /* Draw the widget rect, textured using the image. */
+    struct xform m = *p;
 
-    glPushMatrix();
-    {
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+    /* Draw the widget rect, textured using the image. */
 
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    xf_move(&m, (GLfloat) (widget[id].x + widget[id].w / 2),
+                (GLfloat) (widget[id].y + widget[id].h / 2));
+    xf_scale(&m, widget[id].scale);
 
-        glBindTexture(GL_TEXTURE_2D, widget[id].image);
-        glColor4ub(gui_wht[0], gui_wht[1], gui_wht[2], gui_wht[3]);
-        draw_image(id);
-    }
-    glPopMatrix();
+    batch_grid(layer, widget[id].image, &m,
+               vert_buf + id * WIDGET_VERT + RECT_VERT, 2, 2);
 }
 
-static void gui_paint_count(int id)
+static void gui_paint_count(int id, const struct xform *p)
 {
+    struct xform m = *p;
     int j, i = widget[id].size;
 
-    glPushMatrix();
-    {
-        /* Translate to the widget center, and apply the pulse scale. */
-
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
-
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    /* Translate to the widget center, and apply the pulse scale. */
 
-        if (widget[id].value > 0)
-        {
-            /* Translate right by half the total width of the rendered value. */
+    xf_move(&m, (GLfloat) (widget[id].x + widget[id].w / 2),
+                (GLfloat) (widget[id].y + widget[id].h / 2));
+    xf_scale(&m, widget[id].scale);
 
-            GLfloat w = -widget[digit_id[i][0]].text_w * 0.5f;
+    if (widget[id].value > 0)
+    {
+        /* Translate right by half the total width of the rendered value. */
 
-            for (j = widget[id].value; j; j /= 10)
-                w += widget[digit_id[i][j % 10]].text_w * 0.5f;
+        GLfloat w = -widget[digit_id[i][0]].text_w * 0.5f;
 
-            glTranslatef(w, 0.0f, 0.0f);
+        for (j = widget[id].value; j; j /= 10)
+            w += widget[digit_id[i][j % 10]].text_w * 0.5f;
 
-            /* Render each digit, moving left after each. */
+        xf_move(&m, w, 0.0f);
 
-            for (j = widget[id].value; j; j /= 10)
-            {
-                int jd = digit_id[i][j % 10];
+        /* Render each digit, moving left after each. */
 
-                glBindTexture(GL_TEXTURE_2D, widget[jd].image);
-                draw_text(jd);
-                glTranslatef((GLfloat) -widget[jd].text_w, 0.0f, 0.0f);
-            }
-        }
-        else if (widget[id].value == 0)
+        for (j = widget[id].value; j; j /= 10)
         {
-            /* If the value is zero, just display a zero in place. */
+            int jd = digit_id[i][j % 10];
 
-            glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][0]].image);
-            draw_text(digit_id[i][0]);
+            draw_text(jd, &m);
+            xf_move(&m, (GLfloat) -widget[jd].text_w, 0.0f);
         }
     }
-    glPopMatrix();
+    else if (widget[id].value == 0)
+    {
+        /* If the value is zero, just display a zero in place. */
+
+        draw_text(digit_id[i][0], &m);
+    }
 }
 
-static void gui_paint_clock(int id)
+static void gui_paint_clock(int id, const struct xform *p)
 {
+    struct xform m = *p;
+
     int i  =   widget[id].size;
     int mt =  (widget[id].value / 6000) / 10;
     int mo =  (widget[id].value / 6000) % 10;
@@ -1603,105 +1959,85 @@ static void gui_paint_clock(int id)
     if (widget[id].value < 0)
         return;
 
-    glPushMatrix();
-    {
-        /* Translate to the widget center, and apply the pulse scale. */
-
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+    /* Translate to the widget center, and apply the pulse scale. */
 
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    xf_move(&m, (GLfloat) (widget[id].x + widget[id].w / 2),
+                (GLfloat) (widget[id].y + widget[id].h / 2));
+    xf_scale(&m, widget[id].scale);
 
-        /* Translate left by half the total width of the rendered value. */
+    /* Translate left by half the total width of the rendered value. */
 
-        if (mt > 0)
-            glTranslatef(-2.25f * dx_large, 0.0f, 0.0f);
-        else
-            glTranslatef(-1.75f * dx_large, 0.0f, 0.0f);
+    if (mt > 0)
+        xf_move(&m, -2.25f * dx_large, 0.0f);
+    else
+        xf_move(&m, -1.75f * dx_large, 0.0f);
 
-        /* Render the minutes counter. */
+    /* Render the minutes counter. */
 
-        if (mt > 0)
-        {
-            glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][mt]].image);
-            draw_text(digit_id[i][mt]);
-            glTranslatef(dx_large, 0.0f, 0.0f);
-        }
+    if (mt > 0)
+    {
+        draw_text(digit_id[i][mt], &m);
+        xf_move(&m, dx_large, 0.0f);
+    }
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][mo]].image);
-        draw_text(digit_id[i][mo]);
-        glTranslatef(dx_small, 0.0f, 0.0f);
+    draw_text(digit_id[i][mo], &m);
+    xf_move(&m, dx_small, 0.0f);
 
-        /* Render the colon. */
+    /* Render the colon. */
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][10]].image);
-        draw_text(digit_id[i][10]);
-        glTranslatef(dx_small, 0.0f, 0.0f);
+    draw_text(digit_id[i][10], &m);
+    xf_move(&m, dx_small, 0.0f);
 
-        /* Render the seconds counter. */
+    /* Render the seconds counter. */
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][st]].image);
-        draw_text(digit_id[i][st]);
-        glTranslatef(dx_large, 0.0f, 0.0f);
+    draw_text(digit_id[i][st], &m);
+    xf_move(&m, dx_large, 0.0f);
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][so]].image);
-        draw_text(digit_id[i][so]);
-        glTranslatef(dx_small, 0.0f, 0.0f);
+    draw_text(digit_id[i][so], &m);
+    xf_move(&m, dx_small, 0.0f);
 
-        /* Render hundredths counter half size. */
+    /* Render hundredths counter half size. */
 
-        glScalef(0.5f, 0.5f, 1.0f);
+    xf_scale(&m, 0.5f);
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][ht]].image);
-        draw_text(digit_id[i][ht]);
-        glTranslatef(dx_large, 0.0f, 0.0f);
+    draw_text(digit_id[i][ht], &m);
+    xf_move(&m, dx_large, 0.0f);
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][ho]].image);
-        draw_text(digit_id[i][ho]);
-    }
-    glPopMatrix();
+    draw_text(digit_id[i][ho], &m);
 }
 
-static void gui_paint_label(int id)
+static void gui_paint_label(int id, const struct xform *p)
 {
+    struct xform m = *p;
+
     /* Short-circuit empty labels. */
 
     if (widget[id].image == 0)
         return;
 
-    /* Draw the widget text box, textured using the glyph. */
-
-    glPushMatrix();
-    {
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+    /* Draw the widget text box, textured using the glyph page. */
 
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    xf_move(&m, (GLfloat) (widget[id].x + widget[id].w / 2),
+                (GLfloat) (widget[id].y + widget[id].h / 2));
+    xf_scale(&m, widget[id].scale);
 
-        glBindTexture(GL_TEXTURE_2D, widget[id].image);
-        draw_text(id);
-    }
-    glPopMatrix();
+    draw_text(id, &m);
 }
 
-static void gui_paint_text(int id)
+static void gui_paint_text(int id, const struct xform *m)
 {
     switch (widget[id].type)
     {
     case GUI_SPACE:  break;
     case GUI_FILLER: break;
-    case GUI_HARRAY: gui_paint_array(id); break;
-    case GUI_VARRAY: gui_paint_array(id); break;
-    case GUI_HSTACK: gui_paint_array(id); break;
-    case GUI_VSTACK: gui_paint_array(id); break;
-    case GUI_IMAGE:  gui_paint_image(id); break;
-    case GUI_COUNT:  gui_paint_count(id); break;
-    case GUI_CLOCK:  gui_paint_clock(id); break;
-    default:         gui_paint_label(id); break;
+    case GUI_HARRAY: gui_paint_array(id, m); break;
+    case GUI_VARRAY: gui_paint_array(id, m); break;
+    case GUI_HSTACK: gui_paint_array(id, m); break;
+    case GUI_VSTACK: gui_paint_array(id, m); break;
+    case GUI_IMAGE:  gui_paint_image(id, LAYER_TEXT, m); break;
+    case GUI_COUNT:  gui_paint_count(id, m); break;
+    case GUI_CLOCK:  gui_paint_clock(id, m); break;
+    default:         gui_paint_label(id, m); break;
     }
 }
 
@@ -1709,21 +2045,27 @@ void gui_paint(int id)
 {
     if (id)
     {
+        const struct xform m = { 1.0f, 0.0f, 0.0f };
+
         video_push_ortho();
         {
             glDisable(GL_LIGHTING);
             glDisable(GL_DEPTH_TEST);
             {
-                draw_enable(GL_FALSE, GL_TRUE, GL_TRUE);
-                gui_paint_rect(id, 0, 0);
+                /*
+                 * Gather backgrounds, then text and images, then the
+                 * cursor, and draw them in as few calls as the textures
+                 * allow.
+                 */
 
-                draw_enable(GL_TRUE, GL_TRUE, GL_TRUE);
-                gui_paint_text(id);
+                gui_paint_rect(id, 0, 0);
+                gui_paint_text(id, &m);
 
                 if (cursor_st && cursor_id)
-                    gui_paint_image(cursor_id);
+                    gui_paint_image(cursor_id, LAYER_CURSOR, &m);
+
+                batch_draw();
 
-                draw_disable();
                 glColor4ub(gui_wht[0], gui_wht[1], gui_wht[2], gui_wht[3]);
             }
             glEnable(GL_DEPTH_TEST);
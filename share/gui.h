@@ -72,6 +72,7 @@ void gui_free(void);
 
 void gui_set_label(int, const char *);
 void gui_set_image(int, const char *);
+void gui_set_thumb(int, const char *);
 void gui_set_font(int, const char *);
 void gui_set_multi(int, const char *);
 void gui_set_count(int, int);
@@ -93,6 +94,7 @@ int  gui_vstack(int);
 int  gui_filler(int);
 
 int  gui_image(int, const char *, int, int);
+int  gui_thumb(int, const char *, int, int);
 int  gui_start(int, const char *, int, int, int);
 int  gui_state(int, const char *, int, int, int);
 int  gui_label(int, const char *, int, const GLubyte *, const GLubyte *);
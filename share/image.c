@@ -13,7 +13,7 @@
  */
 
 #include <SDL.h>
-#include <SDL_ttf.h>
+#include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <png.h>
@@ -24,6 +24,7 @@
 #include "base_image.h"
 #include "config.h"
 #include "video.h"
+#include "common.h"
 
 #include "fs.h"
 #include "fs_png.h"
@@ -100,50 +101,118 @@ void image_snap(const char *filename)
 /*---------------------------------------------------------------------------*/
 
 /*
- * Create an OpenGL texture object using the given image buffer.
+ * Texture memory, indexed by texture object.  Each entry is the number
+ * of bytes last uploaded into that object, including mipmaps.  Objects
+ * marked for tallying are also summed in a running total.
  */
-GLuint make_texture(const void *p, int w, int h, int b, int fl)
+
+struct tex_size
 {
-    static const GLenum format[] =
-        { 0, GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
+    int bytes;
+    int tally;
+};
 
-    GLuint o = 0;
+static struct tex_size *tex_sizes;
+static GLuint           tex_sizes_n;
+static int              tex_tally;
 
-    /* Scale the image as configured, or to fit the OpenGL limitations. */
+static struct tex_size *tex_size(GLuint o)
+{
+    if (o >= tex_sizes_n)
+    {
+        GLuint m = tex_sizes_n ? tex_sizes_n : 256;
+        struct tex_size *v;
 
-#ifdef GL_TEXTURE_MAX_ANISOTROPY_EXT
-    int a = config_get_d(CONFIG_ANISO);
-#endif
-#ifdef GL_GENERATE_MIPMAP_SGIS
-    int m = (fl & IF_MIPMAP) ? config_get_d(CONFIG_MIPMAP) : 0;
-#endif
-    int k = config_get_d(CONFIG_TEXTURES);
-    int W = w;
-    int H = h;
+        while (m <= o)
+            m *= 2;
+
+        if (!(v = realloc(tex_sizes, m * sizeof (*v))))
+            return NULL;
+
+        memset(v + tex_sizes_n, 0, (m - tex_sizes_n) * sizeof (*v));
+
+        tex_sizes   = v;
+        tex_sizes_n = m;
+    }
+    return tex_sizes + o;
+}
+
+void image_set_bytes(GLuint o, int n)
+{
+    struct tex_size *tp;
+
+    if ((tp = tex_size(o)))
+    {
+        if (tp->tally)
+            tex_tally += n - tp->bytes;
+
+        tp->bytes = n;
+    }
+}
+
+int image_get_bytes(GLuint o)
+{
+    return (o < tex_sizes_n) ? tex_sizes[o].bytes : 0;
+}
+
+/*
+ * Include a texture object in the running total, or leave it out.
+ */
+void image_set_tally(GLuint o, int t)
+{
+    struct tex_size *tp;
+
+    if ((tp = tex_size(o)) && tp->tally != t)
+    {
+        tex_tally += t ? tp->bytes : -tp->bytes;
+        tp->tally  = t;
+    }
+}
+
+int image_get_tally(void)
+{
+    return tex_tally;
+}
 
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Scale an image down by K, or further to fit the OpenGL limitations.
+ * Return a new buffer, or NULL if the image may be used as is.
+ */
+static void *scale_texture(const void *p, int w, int h, int b, int *W, int *H,
+                           int k)
+{
     GLint max = gli.max_texture_size;
 
-    void *q = NULL;
+    *W = w;
+    *H = h;
 
     while (w / k > (int) max || h / k > (int) max)
         k *= 2;
 
-    if (k > 1)
-        q = image_scale(p, w, h, b, &W, &H, k);
-
-    /* Generate and configure a new OpenGL texture. */
-
-    glGenTextures(1, &o);
-    glBindTexture(GL_TEXTURE_2D, o);
+    return (k > 1) ? image_scale(p, w, h, b, W, H, k) : NULL;
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+/*
+ * Configure filtering of the bound texture object.  Mipmaps are either
+ * supplied by the caller or generated by OpenGL.
+ */
+static void conf_texture(int m, int chain)
+{
+#ifdef GL_TEXTURE_MAX_ANISOTROPY_EXT
+    int a = config_get_d(CONFIG_ANISO);
+#endif
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
+    if (m && chain)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+
 #ifdef GL_GENERATE_MIPMAP_SGIS
-    if (m)
+    if (m && !chain)
     {
         glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, GL_TRUE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
@@ -153,118 +222,522 @@ GLuint make_texture(const void *p, int w, int h, int b, int fl)
 #ifdef GL_TEXTURE_MAX_ANISOTROPY_EXT
     if (a) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, a);
 #endif
+}
+
+/*
+ * Generate and configure a new OpenGL texture object.
+ */
+static GLuint make_texture_object(int m, int chain)
+{
+    GLuint o = 0;
+
+    glGenTextures(1, &o);
+    glBindTexture(GL_TEXTURE_2D, o);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    conf_texture(m, chain);
+
+    return o;
+}
+
+static const GLenum format[] =
+    { 0, GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
+
+/*
+ * Create an OpenGL texture object using the given image buffer.
+ */
+GLuint make_texture(const void *p, int w, int h, int b, int fl)
+{
+    int m = (fl & IF_MIPMAP) ? config_get_d(CONFIG_MIPMAP) : 0;
+    int W;
+    int H;
 
-    /* Copy the image to an OpenGL texture. */
+    GLuint o;
+
+    void *q = scale_texture(p, w, h, b, &W, &H,
+                            config_get_d(CONFIG_TEXTURES));
+
+    /* Copy the image to a new OpenGL texture. */
+
+    o = make_texture_object(m, 0);
 
     glTexImage2D(GL_TEXTURE_2D, 0,
                  format[b], W, H, 0,
                  format[b], GL_UNSIGNED_BYTE, q ? q : p);
 
-    if (q) free(q);
+    image_set_bytes(o, W * H * b * (m ? 4 : 3) / 3);
 
+    if (q) free(q);
 
     return o;
 }
 
+/*---------------------------------------------------------------------------*/
+
 /*
- * Load an image from the named file.  Return an OpenGL texture object.
+ * Decoded texture cache.  Each image file loaded with IF_CACHE is kept in
+ * the user directory at its configured scale, followed by its mipmap
+ * chain, and is read back for as long as the source file and the scale
+ * settings are unchanged.  The cache is trimmed to its configured size
+ * at startup, oldest files first, and is not written beyond it.
  */
-GLuint make_image_from_file(const char *filename, int fl)
+
+#define TEX_CACHE_DIR     "Cache"
+#define TEX_CACHE_MAGIC   0x5854424E
+#define TEX_CACHE_VERSION 3
+
+struct tex_head
 {
-    void  *p;
-    int    w;
-    int    h;
-    int    b;
-    GLuint o = 0;
+    int  magic;
+    int  version;
 
-    /* Load the image. */
+    char path[MAXSTR];                  /* Source file path                  */
+    long mtime;                         /* Source modification time          */
+    int  k;                             /* Configured texture scale          */
+    int  max;                           /* Texture size limit                */
+    int  fl;                            /* Image flags                       */
 
-    if ((p = image_load(filename, &w, &h, &b)))
+    int w, h, b;                        /* Level zero dimensions             */
+    int n;                              /* Level count                       */
+};
+
+struct image_count image_total;
+
+static int          tex_cache_max;      /* Size limit in bytes, zero if off  */
+static SDL_atomic_t tex_cache_used;     /* Bytes in use, updated by workers  */
+
+static void tex_cache_name(char *dst, size_t len, const char *path)
+{
+    unsigned int x = 2166136261u;
+
+    /* Name the cache file after an FNV-1a hash of the source path. */
+
+    while (*path)
+        x = (x ^ (unsigned char) *path++) * 16777619u;
+
+    snprintf(dst, len, "%s/%08x.tex", TEX_CACHE_DIR, x);
+}
+
+/*
+ * Describe the named image as cached with the current settings.  Return
+ * zero if the source file cannot be identified.
+ */
+static int tex_cache_key(struct tex_head *hp, const char *path, int fl)
+{
+    memset(hp, 0, sizeof (*hp));
+
+    hp->magic   = TEX_CACHE_MAGIC;
+    hp->version = TEX_CACHE_VERSION;
+
+    SAFECPY(hp->path, path);
+
+    hp->mtime = fs_mtime(path);
+    hp->k     = config_get_d(CONFIG_TEXTURES);
+    hp->max   = gli.max_texture_size;
+    hp->fl    = fl & IF_MIPMAP;
+
+    return hp->mtime ? 1 : 0;
+}
+
+static int tex_cache_size(const struct tex_head *hp)
+{
+    int w = hp->w;
+    int h = hp->h;
+    int i, c = 0;
+
+    for (i = 0; i < hp->n; i++)
     {
-        o = make_texture(p, w, h, b, fl);
-        free(p);
+        c += w * h * hp->b;
+        w  = (w > 1) ? w / 2 : 1;
+        h  = (h > 1) ? h / 2 : 1;
     }
+    return c;
+}
 
-    return o;
+static int tex_cache_match(const struct tex_head *hp,
+                           const struct tex_head *key, int size)
+{
+    return (size >= (int) sizeof (*hp)       &&
+            hp->magic   == key->magic        &&
+            hp->version == key->version      &&
+            hp->mtime   == key->mtime        &&
+            hp->k       == key->k            &&
+            hp->max     == key->max          &&
+            hp->fl      == key->fl           &&
+            hp->b >= 1 && hp->b <= 4         &&
+            strncmp(hp->path, key->path, MAXSTR) == 0 &&
+            size == (int) sizeof (*hp) + tex_cache_size(hp));
 }
 
-/*---------------------------------------------------------------------------*/
+struct tex_file
+{
+    const char *path;
+    long mtime;
+    int  size;
+};
+
+static int is_tex_file(struct dir_item *item)
+{
+    return str_ends_with(item->path, ".tex");
+}
+
+static int cmp_tex_file(const void *A, const void *B)
+{
+    const struct tex_file *a = A, *b = B;
+
+    /* Newest first. */
+
+    return (a->mtime < b->mtime) - (a->mtime > b->mtime);
+}
 
 /*
- * Render the given  string using the given font.   Transfer the image
- * to a  surface of  power-of-2 size large  enough to fit  the string.
- * Return an OpenGL texture object.
+ * Create the texture cache directory and trim it to the configured size.
+ * Do this once, on the main thread, before any image is loaded elsewhere.
  */
-GLuint make_image_from_font(int *W, int *H,
-                            int *w, int *h,
-                            const char *text, TTF_Font *font, int fl)
+void image_cache_init(void)
 {
-    GLuint o = 0;
+    Array items;
 
-    /* Render the text. */
+    tex_cache_max = config_get_d(CONFIG_TEXTURE_CACHE) * 1024 * 1024;
 
-    if (font && text && strlen(text) > 0)
+    SDL_AtomicSet(&tex_cache_used, 0);
+
+    if (tex_cache_max <= 0)
+        return;
+
+    fs_mkdir(TEX_CACHE_DIR);
+
+    if ((items = fs_dir_scan(TEX_CACHE_DIR, is_tex_file)))
     {
-        SDL_Color    col = { 0xFF, 0xFF, 0xFF, 0xFF };
-        SDL_Surface *orig;
+        int i, n = array_len(items), c = 0;
+        struct tex_file *v;
 
-        if ((orig = TTF_RenderUTF8_Blended(font, text, col)))
+        if ((v = calloc(n ? n : 1, sizeof (*v))))
         {
-            void *p;
-            int  w2;
-            int  h2;
-            int   b = orig->format->BitsPerPixel / 8;
+            for (i = 0; i < n; i++)
+            {
+                fs_file fp;
 
-            SDL_Surface *src;
-            SDL_PixelFormat fmt;
+                v[i].path  = DIR_ITEM_GET(items, i)->path;
+                v[i].mtime = fs_mtime(v[i].path);
 
-            fmt = *orig->format;
+                if ((fp = fs_open(v[i].path, "r")))
+                {
+                    v[i].size = fs_length(fp);
+                    fs_close(fp);
+                }
+            }
 
-            fmt.Rmask = RMASK;
-            fmt.Gmask = GMASK;
-            fmt.Bmask = BMASK;
-            fmt.Amask = AMASK;
+            qsort(v, n, sizeof (*v), cmp_tex_file);
 
-            if ((src = SDL_ConvertSurface(orig, &fmt, orig->flags)) == NULL)
-            {
-                /* Pretend everything's just fine. */
+            /* Keep the newest files that fit and remove the rest. */
+
+            for (i = 0; i < n; i++)
+                if (c + v[i].size <= tex_cache_max)
+                    c += v[i].size;
+                else
+                    fs_remove(v[i].path);
+
+            free(v);
+        }
+        fs_dir_free(items);
+
+        SDL_AtomicSet(&tex_cache_used, c);
+    }
+}
+
+/*
+ * Read a cached image with a single read.
+ */
+static int tex_cache_load(struct image_tex *tp, const struct tex_head *key)
+{
+    char name[MAXSTR];
+    void *data;
+    int size;
+
+    tex_cache_name(name, sizeof (name), key->path);
+
+    if ((data = fs_load(name, &size)))
+    {
+        const struct tex_head *hp = (const struct tex_head *) data;
+
+        if (tex_cache_match(hp, key, size))
+        {
+            tp->w = hp->w;
+            tp->h = hp->h;
+            tp->b = hp->b;
+            tp->n = hp->n;
+            tp->p = data;
+
+            /* Slide the levels down over the header. */
+
+            memmove(data, hp + 1, size - sizeof (*hp));
+            return 1;
+        }
+        free(data);
+    }
+    return 0;
+}
+
+static void tex_cache_save(const struct tex_head *hp, const void *p)
+{
+    int n = (int) sizeof (*hp) + tex_cache_size(hp);
+
+    char name[MAXSTR];
+    fs_file fp;
 
-                src = orig;
+    /* Claim space for the file, or give up if the cache is full. */
+
+    if (SDL_AtomicAdd(&tex_cache_used, n) + n > tex_cache_max)
+    {
+        SDL_AtomicAdd(&tex_cache_used, -n);
+        return;
+    }
+
+    tex_cache_name(name, sizeof (name), hp->path);
+
+    if ((fp = fs_open(name, "w")))
+    {
+        fs_write(hp, sizeof (*hp), 1, fp);
+        fs_write(p, tex_cache_size(hp), 1, fp);
+        fs_close(fp);
+    }
+}
+
+/*
+ * Fit an image, decoded at its configured scale, to the texture size
+ * limit and append its mipmap chain, if requested.  Note the result
+ * dimensions in the cache header.
+ */
+static void *tex_cache_make(struct tex_head *hp, const void *p,
+                            int w, int h, int b)
+{
+    unsigned char *c = NULL;
+    void *q = scale_texture(p, w, h, b, &hp->w, &hp->h, 1);
+
+    hp->b = b;
+    hp->n = 1;
+
+    if (hp->fl & IF_MIPMAP)
+        while ((hp->w >> hp->n) > 0 || (hp->h >> hp->n) > 0)
+            hp->n++;
+
+    if ((c = (unsigned char *) malloc(tex_cache_size(hp))))
+    {
+        unsigned char *d = c;
+        int W = hp->w;
+        int H = hp->h;
+        int i;
+
+        memcpy(d, q ? q : p, W * H * b);
+
+        for (i = 1; i < hp->n; i++)
+        {
+            unsigned char *m;
+            int MW, MH;
+
+            if (!(m = image_mip(d, W, H, b, &MW, &MH)))
+            {
+                free(c);
+                c = NULL;
+                break;
             }
-            else
-                SDL_FreeSurface(orig);
 
-            /* Pad the text to power-of-two. */
+            d += W * H * b;
+            memcpy(d, m, MW * MH * b);
+            free(m);
+
+            W = MW;
+            H = MH;
+        }
+    }
+
+    if (q) free(q);
+
+    return c;
+}
+
+/*
+ * Load the named image file as an uploadable chain of levels, from the
+ * texture cache if possible.  This touches no GL state, so it may run on
+ * any thread.
+ */
+int image_load_tex(struct image_tex *tp, const char *filename, int fl)
+{
+    struct tex_head head;
 
-            p = image_next2(src->pixels, src->w, src->h, b, &w2, &h2);
+    Uint32 t0 = SDL_GetTicks();
 
-            if (w) *w = src->w;
-            if (h) *h = src->h;
-            if (W) *W = w2;
-            if (H) *H = h2;
+    void *p;
+    int   w;
+    int   h;
+    int   b;
+    int   c;
 
-            /* Saturate the color channels.  Modulate ONLY in alpha. */
+    memset(tp, 0, sizeof (*tp));
 
-            image_white(p, w2, h2, b);
+    /* Only images flagged for it are cached, and only if known. */
 
-            /* Create the OpenGL texture object. */
+    c = tex_cache_key(&head, filename, fl) && (fl & IF_CACHE) &&
+        tex_cache_max > 0;
 
-            o = make_texture(p, w2, h2, b, fl);
+    /* Use the cached image, or decode the file and cache it. */
 
+    if (c && tex_cache_load(tp, &head))
+        tp->cached = 1;
+
+    else if ((p = image_load_scaled(filename, &w, &h, &b, head.k)))
+    {
+        if ((tp->p = tex_cache_make(&head, p, w, h, b)))
+        {
+            if (c)
+                tex_cache_save(&head, tp->p);
+
+            tp->w = head.w;
+            tp->h = head.h;
+            tp->b = head.b;
+            tp->n = head.n;
+        }
+        free(p);
+    }
+
+    tp->ms = (int) (SDL_GetTicks() - t0);
+
+    return tp->p ? 1 : 0;
+}
+
+/*
+ * Upload a loaded image chain into the given texture object, or a new
+ * one if none is given.  Return the texture object.
+ */
+GLuint image_make_tex(GLuint o, const struct image_tex *tp)
+{
+    const unsigned char *c = (const unsigned char *) tp->p;
+
+    int m = (tp->n > 1) ? config_get_d(CONFIG_MIPMAP) : 0;
+    int w = tp->w;
+    int h = tp->h;
+    int i, n = 0;
+
+    if (o)
+    {
+        glBindTexture(GL_TEXTURE_2D, o);
+        conf_texture(m, 1);
+    }
+    else o = make_texture_object(m, 1);
+
+    for (i = 0; i < (m ? tp->n : 1); i++)
+    {
+        glTexImage2D(GL_TEXTURE_2D, i,
+                     format[tp->b], w, h, 0,
+                     format[tp->b], GL_UNSIGNED_BYTE, c);
+
+        c += w * h * tp->b;
+        n += w * h * tp->b;
+        w  = (w > 1) ? w / 2 : 1;
+        h  = (h > 1) ? h / 2 : 1;
+    }
+
+    image_set_bytes(o, n);
+
+    return o;
+}
+
+/*
+ * Load an image as a W by H RGBA thumbnail.  The image is reduced by a
+ * box filter while it remains at least thumbnail size, then resampled.
+ */
+int image_load_thumb(struct image_tex *tp, const char *filename, int W, int H)
+{
+    Uint32 t0 = SDL_GetTicks();
+
+    unsigned char *p;
+    unsigned char *q;
+
+    int w, h, b, i, j, k = 1;
+
+    memset(tp, 0, sizeof (*tp));
+
+    if ((p = image_load(filename, &w, &h, &b)))
+    {
+        while (w / (k * 2) >= W && h / (k * 2) >= H)
+            k *= 2;
+
+        if (k > 1 && (q = image_scale(p, w, h, b, &w, &h, k)))
+        {
             free(p);
-            SDL_FreeSurface(src);
+            p = q;
         }
+
+        if ((q = malloc(W * H * 4)))
+        {
+            for (i = 0; i < H; i++)
+                for (j = 0; j < W; j++)
+                {
+                    const unsigned char *s = p + ((i * h / H) * w +
+                                                  (j * w / W)) * b;
+                    unsigned char       *d = q + (i * W + j) * 4;
+
+                    d[0] = s[0];
+                    d[1] = (b < 3) ? s[0] : s[1];
+                    d[2] = (b < 3) ? s[0] : s[2];
+                    d[3] = (b == 2) ? s[1] : ((b == 4) ? s[3] : 0xFF);
+                }
+
+            tp->p = q;
+            tp->w = W;
+            tp->h = H;
+            tp->b = 4;
+            tp->n = 1;
+        }
+        free(p);
     }
+
+    tp->ms = (int) (SDL_GetTicks() - t0);
+
+    return tp->p ? 1 : 0;
+}
+
+/*
+ * Upload a loaded thumbnail into texture object O at X, Y.
+ */
+void image_put_thumb(GLuint o, int x, int y, const struct image_tex *tp)
+{
+    glBindTexture(GL_TEXTURE_2D, o);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, tp->w, tp->h,
+                    GL_RGBA, GL_UNSIGNED_BYTE, tp->p);
+}
+
+/*
+ * Note a loaded image in the load counters.
+ */
+void image_count_tex(const struct image_tex *tp)
+{
+    if (tp->cached)
+        image_total.hits++;
     else
+        image_total.misses++;
+
+    image_total.ms += tp->ms;
+}
+
+/*
+ * Load an image from the named file.  Return an OpenGL texture object.
+ */
+GLuint make_image_from_file(const char *filename, int fl)
+{
+    struct image_tex tex;
+    GLuint o = 0;
+
+    if (image_load_tex(&tex, filename, fl))
     {
-        /* Empty string. */
+        o = image_make_tex(0, &tex);
 
-        if (w) *w = 0;
-        if (h) *h = 0;
-        if (W) *W = 0;
-        if (H) *H = 0;
+        image_count_tex(&tex);
+        free(tex.p);
     }
-
     return o;
 }
 
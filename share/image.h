@@ -2,7 +2,6 @@
 #define IMAGE_H
 
 #include <SDL.h>
-#include <SDL_ttf.h>
 
 #include "glext.h"
 #include "base_image.h"
@@ -10,6 +9,7 @@
 /*---------------------------------------------------------------------------*/
 
 #define IF_MIPMAP 0x01
+#define IF_CACHE  0x02
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
 #define RMASK 0xFF000000
@@ -23,11 +23,50 @@
 #define AMASK 0xFF000000
 #endif
 
+/*
+ * Image loading counters, summed across all loads.
+ */
+
+struct image_count
+{
+    int hits;                           /* Images read from the cache        */
+    int misses;                         /* Images decoded from source        */
+    int ms;                             /* Milliseconds spent loading        */
+};
+
+extern struct image_count image_total;
+
+/*
+ * An image loaded for upload as a texture, followed by its mipmaps.
+ */
+
+struct image_tex
+{
+    void *p;                            /* Levels, each following the last   */
+    int   w, h, b;                      /* Level zero dimensions             */
+    int   n;                            /* Level count                       */
+    int   cached;                       /* Read from the texture cache       */
+    int   ms;                           /* Milliseconds spent loading        */
+};
+
+void   image_cache_init(void);
+
+int    image_load_tex(struct image_tex *, const char *, int);
+GLuint image_make_tex(GLuint, const struct image_tex *);
+
+int    image_load_thumb(struct image_tex *, const char *, int, int);
+void   image_put_thumb(GLuint, int, int, const struct image_tex *);
+void   image_count_tex(const struct image_tex *);
+
+void   image_set_bytes(GLuint, int);
+int    image_get_bytes(GLuint);
+
+void   image_set_tally(GLuint, int);
+int    image_get_tally(void);
+
 void   image_snap(const char *);
 
 GLuint make_image_from_file(const char *, int);
-GLuint make_image_from_font(int *, int *,
-                            int *, int *, const char *, TTF_Font *, int);
 GLuint make_texture(const void *, int, int, int, int);
 
 SDL_Surface *load_surface(const char *);
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include <SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image_async.h"
+#include "image.h"
+#include "common.h"
+#include "log.h"
+
+/*
+ * Background texture loading.  Worker threads resolve image file names
+ * and decode them into texture-ready level chains.  The main thread
+ * uploads finished images within a per-frame time budget into texture
+ * objects handed out up front, which show a white placeholder until
+ * then.  Workers never touch GL state.
+ */
+
+#define JOB_PATHS  4
+#define THREAD_MAX 4
+
+enum
+{
+    JOB_WAIT = 0,
+    JOB_WORK,
+    JOB_DONE
+};
+
+struct job
+{
+    struct job *next;
+
+    int    state;
+    GLuint o;                           /* Target texture, zero if dropped   */
+    int    fl;                          /* Image flags                       */
+    int    ok;                          /* Image was found and decoded       */
+
+    int    x, y;                        /* Target region, for thumbnails     */
+    int    w, h;                        /* Thumbnail size, zero otherwise    */
+
+    char path[JOB_PATHS][MAXSTR];       /* Candidate file names, in order    */
+    int  pc;
+
+    struct image_tex tex;
+};
+
+static SDL_mutex  *mutex;
+static SDL_cond   *cond;
+static SDL_Thread *threads[THREAD_MAX];
+static int         thread_c;
+static int         running;
+
+static struct job *head;
+static struct job *tail;
+
+/*
+ * Streaming statistics, from the first queued job until drained.  The
+ * load counters are kept by the workers, under the mutex, and added to
+ * the image totals once the stream drains.
+ */
+
+static Uint32 stream_t0;
+static int    stream_c;
+
+static struct image_count stream_count;
+
+/*---------------------------------------------------------------------------*/
+
+static void job_work(struct job *jp)
+{
+    int i;
+
+    /* Try each candidate until one decodes. */
+
+    for (i = 0; i < jp->pc && !jp->ok; i++)
+        if (jp->w)
+            jp->ok = image_load_thumb(&jp->tex, jp->path[i], jp->w, jp->h);
+        else
+            jp->ok = image_load_tex  (&jp->tex, jp->path[i], jp->fl);
+}
+
+static int async_func(void *data)
+{
+    SDL_LockMutex(mutex);
+
+    while (running)
+    {
+        struct job *jp;
+
+        for (jp = head; jp && jp->state != JOB_WAIT; jp = jp->next)
+            ;
+
+        if (jp)
+        {
+            jp->state = JOB_WORK;
+
+            /* Skip work for textures deleted while waiting. */
+
+            if (jp->o)
+            {
+                SDL_UnlockMutex(mutex);
+                job_work(jp);
+                SDL_LockMutex(mutex);
+
+                if (jp->ok)
+                {
+                    if (jp->tex.cached)
+                        stream_count.hits++;
+                    else
+                        stream_count.misses++;
+
+                    stream_count.ms += jp->tex.ms;
+                }
+            }
+
+            jp->state = JOB_DONE;
+        }
+        else SDL_CondWait(cond, mutex);
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return 0;
+}
+
+static void job_free(struct job *jp)
+{
+    free(jp->tex.p);
+    free(jp);
+}
+
+/*---------------------------------------------------------------------------*/
+
+int image_async_init(void)
+{
+    int i, n = CLAMP(1, SDL_GetCPUCount() - 1, THREAD_MAX);
+
+    image_async_quit();
+
+    /* The workers may write the texture cache, so create it first. */
+
+    image_cache_init();
+
+    if ((mutex = SDL_CreateMutex()) && (cond = SDL_CreateCond()))
+    {
+        running = 1;
+
+        for (i = 0; i < n; i++)
+            if ((threads[thread_c] = SDL_CreateThread(async_func,
+                                                      "image", NULL)))
+                thread_c++;
+    }
+    return thread_c;
+}
+
+void image_async_quit(void)
+{
+    int i;
+
+    if (mutex)
+    {
+        /* Stop the workers and wait for them to finish. */
+
+        SDL_LockMutex(mutex);
+        running = 0;
+        SDL_CondBroadcast(cond);
+        SDL_UnlockMutex(mutex);
+
+        for (i = 0; i < thread_c; i++)
+            SDL_WaitThread(threads[i], NULL);
+
+        thread_c = 0;
+
+        /* Release unfinished jobs. */
+
+        while (head)
+        {
+            struct job *jp = head;
+
+            head = jp->next;
+            job_free(jp);
+        }
+        tail = NULL;
+
+        if (cond) SDL_DestroyCond(cond);
+
+        SDL_DestroyMutex(mutex);
+
+        mutex = NULL;
+        cond  = NULL;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+static GLuint make_placeholder(void)
+{
+    static const GLubyte p[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+    GLuint o = 0;
+
+    glGenTextures(1, &o);
+    glBindTexture(GL_TEXTURE_2D, o);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, p);
+
+    image_set_bytes(o, sizeof (p));
+
+    return o;
+}
+
+/*
+ * Queue the first of the named image files that exists for loading.
+ * Return a placeholder texture object that receives the image once it
+ * is decoded, or zero if background loading is unavailable.
+ */
+GLuint image_async_load(const char *const *paths, int n, int fl)
+{
+    struct job *jp;
+    int i;
+
+    if (thread_c == 0 || !(jp = (struct job *) calloc(1, sizeof (*jp))))
+        return 0;
+
+    for (i = 0; i < n && i < JOB_PATHS; i++)
+        SAFECPY(jp->path[i], paths[i]);
+
+    jp->pc = i;
+    jp->fl = fl;
+    jp->o  = make_placeholder();
+
+    SDL_LockMutex(mutex);
+    {
+        if (head == NULL)
+        {
+            stream_t0 = SDL_GetTicks();
+            stream_c  = 0;
+        }
+
+        if (tail)
+            tail->next = jp;
+        else
+            head = jp;
+
+        tail = jp;
+
+        SDL_CondSignal(cond);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return jp->o;
+}
+
+/*
+ * Queue the named image for loading as a W by H thumbnail into the
+ * region of texture object O at X, Y, replacing any load pending there.
+ * Return zero if background loading is unavailable.
+ */
+int image_async_thumb(const char *path, GLuint o, int x, int y, int w, int h)
+{
+    struct job *jp;
+    struct job *jq;
+
+    if (thread_c == 0 || !(jp = (struct job *) calloc(1, sizeof (*jp))))
+        return 0;
+
+    SAFECPY(jp->path[0], path);
+
+    jp->pc = 1;
+    jp->o  = o;
+    jp->x  = x;
+    jp->y  = y;
+    jp->w  = w;
+    jp->h  = h;
+
+    SDL_LockMutex(mutex);
+    {
+        for (jq = head; jq; jq = jq->next)
+            if (jq->o == o && jq->w && jq->x == x && jq->y == y)
+                jq->o = 0;
+
+        if (head == NULL)
+        {
+            stream_t0 = SDL_GetTicks();
+            stream_c  = 0;
+        }
+
+        if (tail)
+            tail->next = jp;
+        else
+            head = jp;
+
+        tail = jp;
+
+        SDL_CondSignal(cond);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return 1;
+}
+
+/*
+ * Cancel any pending load into the given texture object.
+ */
+void image_async_drop(GLuint o)
+{
+    struct job *jp;
+
+    if (o && mutex)
+    {
+        SDL_LockMutex(mutex);
+
+        for (jp = head; jp; jp = jp->next)
+            if (jp->o == o)
+                jp->o = 0;
+
+        SDL_UnlockMutex(mutex);
+    }
+}
+
+/*
+ * Upload finished images until the given number of milliseconds has
+ * passed, or all of them if it is zero.  At least one upload is made.
+ * Return the number of images still in flight.
+ */
+int image_async_step(int ms)
+{
+    Uint32 t0 = SDL_GetTicks();
+
+    struct job *jp;
+    struct job *jq = NULL;
+
+    int c = 0;
+    int n = 0;
+
+    if (thread_c == 0)
+        return 0;
+
+    SDL_LockMutex(mutex);
+
+    for (jp = head; jp; )
+    {
+        struct job *jn = jp->next;
+
+        if (jp->state == JOB_DONE &&
+            (c == 0 || ms <= 0 || SDL_GetTicks() - t0 < (Uint32) ms))
+        {
+            /* Unlink the job.  Only this thread modifies the list. */
+
+            if (jq)
+                jq->next = jn;
+            else
+                head = jn;
+
+            if (tail == jp)
+                tail = jq;
+
+            SDL_UnlockMutex(mutex);
+            {
+                if (jp->o && jp->ok)
+                {
+                    if (jp->w)
+                        image_put_thumb(jp->o, jp->x, jp->y, &jp->tex);
+                    else
+                        image_make_tex(jp->o, &jp->tex);
+
+                    stream_c++;
+                }
+                job_free(jp);
+            }
+            SDL_LockMutex(mutex);
+
+            c++;
+        }
+        else
+        {
+            jq = jp;
+            n++;
+        }
+
+        jp = jn;
+    }
+
+    /* Once drained, report the stream and add it to the totals. */
+
+    if (c && n == 0)
+    {
+        if (stream_c)
+            log_printf("Streamed %d textures in %d ms "
+                       "(%d cached, %d decoded, %d ms)\n",
+                       stream_c, (int) (SDL_GetTicks() - stream_t0),
+                       stream_count.hits,
+                       stream_count.misses,
+                       stream_count.ms);
+
+        image_total.hits   += stream_count.hits;
+        image_total.misses += stream_count.misses;
+        image_total.ms     += stream_count.ms;
+
+        memset(&stream_count, 0, sizeof (stream_count));
+        stream_c = 0;
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    if (c)
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+    return n;
+}
+
+/*
+ * Return the number of images queued but not yet uploaded.
+ */
+int image_async_count(void)
+{
+    struct job *jp;
+    int n = 0;
+
+    if (thread_c)
+    {
+        SDL_LockMutex(mutex);
+
+        for (jp = head; jp; jp = jp->next)
+            n++;
+
+        SDL_UnlockMutex(mutex);
+    }
+    return n;
+}
+
+/*
+ * Block until all queued images are uploaded.
+ */
+void image_async_wait(void)
+{
+    while (image_async_step(0))
+        SDL_Delay(1);
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,21 @@
+#ifndef IMAGE_ASYNC_H
+#define IMAGE_ASYNC_H
+
+#include "glext.h"
+
+/*---------------------------------------------------------------------------*/
+
+int    image_async_init(void);
+void   image_async_quit(void);
+
+GLuint image_async_load(const char *const *, int, int);
+int    image_async_thumb(const char *, GLuint, int, int, int, int);
+void   image_async_drop(GLuint);
+
+int    image_async_step(int);
+int    image_async_count(void);
+void   image_async_wait(void);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Time the image kernels of base_image.c over typical texture sizes and
+ * check that each produces exactly the output of the plain per-component
+ * loops it replaced, kept here for reference.  Exits non-zero on any
+ * mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "base_image.h"
+
+/*---------------------------------------------------------------------------*/
+
+static void *ref_next2(const void *p, int w, int h, int b, int *w2, int *h2)
+{
+    const unsigned char *src = (const unsigned char *) p;
+    unsigned char *dst;
+
+    int W, H, r;
+
+    image_size(&W, &H, w, h);
+
+    if ((dst = (unsigned char *) calloc(W * H * b, 1)))
+    {
+        for (r = 0; r < h; ++r)
+            memcpy(&dst[((r + (H - h) / 2) * W + (W - w) / 2) * b],
+                   &src[(r * w) * b], w * b);
+
+        *w2 = W;
+        *h2 = H;
+    }
+    return dst;
+}
+
+static void *ref_scale(const void *p, int w, int h, int b, int n)
+{
+    const unsigned char *src = (const unsigned char *) p;
+    unsigned char *dst;
+
+    int W = w / n;
+    int H = h / n;
+
+    if ((dst = (unsigned char *) calloc(W * H * b, 1)))
+    {
+        int si, di, sj, dj, i;
+
+        for (di = 0; di < H; di++)
+            for (dj = 0; dj < W; dj++)
+                for (i = 0; i < b; i++)
+                {
+                    int c = 0;
+
+                    for (si = di * n; si < (di + 1) * n; si++)
+                        for (sj = dj * n; sj < (dj + 1) * n; sj++)
+                            c += src[(si * w + sj) * b + i];
+
+                    dst[(di * W + dj) * b + i] = (unsigned char) (c / (n * n));
+                }
+    }
+    return dst;
+}
+
+static void ref_white(void *p, int w, int h, int b)
+{
+    unsigned char *s = (unsigned char *) p;
+    int i;
+
+    if (b == 1 || b == 3)
+        memset(s, 0xFF, w * h * b);
+    else if (b == 2)
+        for (i = 0; i < w * h * b; i += 2)
+            s[i] = 0xFF;
+    else
+        for (i = 0; i < w * h * b; i += 4)
+        {
+            s[i + 0] = 0xFF;
+            s[i + 1] = 0xFF;
+            s[i + 2] = 0xFF;
+        }
+}
+
+static void *ref_flip(const void *p, int w, int h, int b, int hflip, int vflip)
+{
+    unsigned char *q;
+
+    if ((q = malloc(w * b * h)))
+    {
+        int r, c, i;
+
+        for (r = 0; r < h; r++)
+            for (c = 0; c < w; c++)
+                for (i = 0; i < b; i++)
+                {
+                    int pr = vflip ? h - r - 1 : r;
+                    int pc = hflip ? w - c - 1 : c;
+
+                    q[(r * w + c) * b + i] =
+                        ((const unsigned char *) p)[(pr * w + pc) * b + i];
+                }
+    }
+    return q;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static double now(void)
+{
+    struct timeval t;
+
+    gettimeofday(&t, 0);
+
+    return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+}
+
+static int fail;
+
+static void report(const char *name, int w, int h, int b,
+                   double t0, double t1, int n, int ok)
+{
+    printf("%-8s %5d %5d %2d %10.3f %10.3f %7.2fx %s\n", name, w, h, b,
+           t0 / n, t1 / n, t1 > 0.0 ? t0 / t1 : 0.0, ok ? "ok" : "MISMATCH");
+
+    if (!ok)
+        fail++;
+}
+
+static void bench(const unsigned char *p, int w, int h, int b, int n)
+{
+    const int s = w * h * b;
+
+    unsigned char *a = malloc(s);
+    unsigned char *c = malloc(s);
+    void *x = NULL;
+    void *y = NULL;
+
+    double t0, t1;
+    int i, k, W, H, V, U;
+
+    /* Power-of-two padding. */
+
+    t0 = now();
+    for (i = 0; i < n; i++, free(x)) x = ref_next2(p, w, h, b, &W, &H);
+    t0 = now() - t0;
+
+    t1 = now();
+    for (i = 0; i < n; i++, free(y)) y = image_next2(p, w, h, b, &V, &U);
+    t1 = now() - t1;
+
+    x = ref_next2(p, w, h, b, &W, &H);
+    y = image_next2(p, w, h, b, &V, &U);
+
+    report("next2", w, h, b, t0, t1, n,
+           x && y && V == W && U == H && !memcmp(x, y, W * H * b));
+    free(x);
+    free(y);
+
+    /* Down-sampling by two and by four. */
+
+    for (k = 2; k <= 4; k += 2)
+    {
+        t0 = now();
+        for (i = 0; i < n; i++, free(x)) x = ref_scale(p, w, h, b, k);
+        t0 = now() - t0;
+
+        t1 = now();
+        for (i = 0; i < n; i++, free(y))
+            y = image_scale(p, w, h, b, &V, &U, k);
+        t1 = now() - t1;
+
+        x = ref_scale(p, w, h, b, k);
+        y = image_scale(p, w, h, b, &V, &U, k);
+
+        report(k == 2 ? "scale2" : "scale4", w, h, b, t0, t1, n,
+               x && y && V == w / k && U == h / k &&
+               !memcmp(x, y, V * U * b));
+        free(x);
+        free(y);
+    }
+
+    /* Whitening, in place on a fresh copy each time. */
+
+    t0 = 0.0;
+    t1 = 0.0;
+
+    for (i = 0; i < n; i++)
+    {
+        double t;
+
+        memcpy(a, p, s);
+        t = now(); ref_white(a, w, h, b);   t0 += now() - t;
+        memcpy(c, p, s);
+        t = now(); image_white(c, w, h, b); t1 += now() - t;
+    }
+    report("white", w, h, b, t0, t1, n, !memcmp(a, c, s));
+
+    /* Flipping, each way. */
+
+    for (k = 1; k <= 3; k++)
+    {
+        static const char *name[] = { "", "hflip", "vflip", "hvflip" };
+
+        t0 = now();
+        for (i = 0; i < n; i++, free(x))
+            x = ref_flip(p, w, h, b, k & 1, k & 2);
+        t0 = now() - t0;
+
+        t1 = now();
+        for (i = 0; i < n; i++, free(y))
+            y = image_flip(p, w, h, b, k & 1, k & 2);
+        t1 = now() - t1;
+
+        x = ref_flip(p, w, h, b, k & 1, k & 2);
+        y = image_flip(p, w, h, b, k & 1, k & 2);
+
+        report(name[k], w, h, b, t0, t1, n, x && y && !memcmp(x, y, s));
+        free(x);
+        free(y);
+    }
+
+    free(a);
+    free(c);
+}
+
+int main(int argc, char *argv[])
+{
+    /* Texture sizes, plus odd ones to exercise the scalar remainders. */
+
+    static const int size[][2] = {
+        {  256,  256 }, {  512,  512 }, { 1024, 1024 },
+        {  123,   77 }, {  301,   45 }
+    };
+
+    unsigned char *p;
+    int i, b, n = 10;
+
+    if (argc > 1 && atoi(argv[1]) > 0)
+        n = atoi(argv[1]);
+
+    if (!(p = malloc(1024 * 1024 * 4)))
+        return 1;
+
+    /* Fill with noise, so that every rounding case turns up. */
+
+    srand(1);
+
+    for (i = 0; i < 1024 * 1024 * 4; i++)
+        p[i] = (unsigned char) (rand() >> 4);
+
+    printf("%-8s %5s %5s %2s %10s %10s %8s\n",
+           "kernel", "w", "h", "b", "ref ms", "ms", "speedup");
+
+    for (i = 0; i < (int) (sizeof (size) / sizeof (size[0])); i++)
+        for (b = 1; b <= 4; b++)
+            bench(p, size[i][0], size[i][1], b, n);
+
+    free(p);
+
+    if (fail)
+        fprintf(stderr, "%d kernel mismatches\n", fail);
+
+    return fail ? 1 : 0;
+}
+
+/*---------------------------------------------------------------------------*/
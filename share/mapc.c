@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <stddef.h> /* offsetof */
 #include <string.h>
+#include <ctype.h>
 #include <math.h>
 #include <sys/time.h>
 #include <assert.h>
@@ -38,6 +39,12 @@
 #include "fs.h"
 #include "common.h"
 
+#ifdef _OPENMP
+#define OMP(x) _Pragma(#x)
+#else
+#define OMP(x)
+#endif
+
 #define MAXSTR 256
 #define MAXKEY 16
 #define SCALE  64.f
@@ -55,6 +62,8 @@
 
 static const char *input_file;
 static int         debug_output = 0;
+static int          mesh_output = 1;
+static int        overdraw_sort = 0;
 static int           csv_output = 0;
 
 /*---------------------------------------------------------------------------*/
@@ -372,6 +381,9 @@ static void init_file(struct s_base *fp)
     fp->dc = 0;
     fp->ac = 0;
     fp->ic = 0;
+    fp->kc = 0;
+    fp->yc = 0;
+    fp->qc = 0;
 
     fp->mv = (struct b_mtrl *) calloc(MAXM, sizeof (*fp->mv));
     fp->vv = (struct b_vert *) calloc(MAXV, sizeof (*fp->vv));
@@ -394,6 +406,12 @@ static void init_file(struct s_base *fp)
     fp->dv = (struct b_dict *) calloc(MAXD, sizeof (*fp->dv));
     fp->av = (char *)          calloc(MAXA, sizeof (*fp->av));
     fp->iv = (int *)           calloc(MAXI, sizeof (*fp->iv));
+
+    /* Meshes are sized and allocated by mesh_file. */
+
+    fp->kv = NULL;
+    fp->yv = NULL;
+    fp->qv = NULL;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -717,6 +735,169 @@ static void move_file(struct s_base *fp)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Source files are read into memory whole  and split into lines exactly
+ * as fs_gets would.  Numbers are parsed by hand where the result is sure
+ * to match scanf: up to 24 bits of digits and 10 decimal places, which
+ * a single correctly  rounded division converts.  Anything else is left
+ * to the C library.
+ */
+
+struct scan
+{
+    char *buf;
+    int   len;
+    int   pos;
+};
+
+static const float scan_pow10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static void scan_init(struct scan *sp, fs_file fin)
+{
+    sp->pos = 0;
+    sp->len = fs_length(fin) - fs_tell(fin);
+    sp->buf = NULL;
+
+    if (sp->len <= 0 || !(sp->buf = (char *) malloc(sp->len)) ||
+        (sp->len = fs_read(sp->buf, 1, sp->len, fin)) < 0)
+        sp->len = 0;
+}
+
+static void scan_free(struct scan *sp)
+{
+    free(sp->buf);
+    memset(sp, 0, sizeof (*sp));
+}
+
+static char *scan_gets(char *dst, int count, struct scan *sp)
+{
+    char *s = dst;
+
+    while (count > 1 && sp->pos < sp->len)
+    {
+        const char c = sp->buf[sp->pos++];
+
+        /* Ignore carriage returns, keep a newline and break. */
+
+        if (c == '\r')
+            continue;
+
+        *s++ = c;
+        count--;
+
+        if (c == '\n')
+            break;
+    }
+
+    if (s == dst)
+        return NULL;
+
+    *s = '\0';
+
+    return dst;
+}
+
+static int scan_float(const char **sp, float *f)
+{
+    const char *s = *sp;
+
+    unsigned long m = 0;
+    int n = 0, e = 0, neg = 0;
+
+    while (isspace((unsigned char) *s))
+        s++;
+
+    if (*s == '-' || *s == '+')
+        neg = (*s++ == '-');
+
+    for (; isdigit((unsigned char) *s) && m <= (1UL << 24); s++, n++)
+        m = m * 10 + (*s - '0');
+
+    if (*s == '.')
+        for (s++; isdigit((unsigned char) *s) && m <= (1UL << 24); s++, n++, e++)
+            m = m * 10 + (*s - '0');
+
+    if (n > 0 && m <= (1UL << 24) && e < ARRAYSIZE(scan_pow10) &&
+        !isalnum((unsigned char) *s) && *s != '.')
+    {
+        *f  = e ? (float) m / scan_pow10[e] : (float) m;
+        *f  = neg ? -*f : *f;
+        *sp = s;
+        return 1;
+    }
+    else
+    {
+        char *t;
+
+        *f = strtof(*sp, &t);
+
+        if (t == *sp)
+            return 0;
+
+        *sp = t;
+        return 1;
+    }
+}
+
+static int scan_int(const char **sp, int *i)
+{
+    char *t;
+    long  l = strtol(*sp, &t, 10);
+
+    if (t == *sp)
+        return 0;
+
+    *i  = (int) l;
+    *sp = t;
+    return 1;
+}
+
+static int scan_char(const char **sp, char *c, int skip)
+{
+    if (skip)
+        while (isspace((unsigned char) **sp))
+            (*sp)++;
+
+    if (**sp == '\0')
+        return 0;
+
+    *c = *(*sp)++;
+    return 1;
+}
+
+static int scan_word(const char **sp, char *w)
+{
+    const char *s = *sp;
+
+    while (isspace((unsigned char) *s))
+        s++;
+
+    if (*s == '\0')
+        return 0;
+
+    while (*s && !isspace((unsigned char) *s))
+        *w++ = *s++;
+
+    *w  = '\0';
+    *sp = s;
+    return 1;
+}
+
+static int scan_floats(const char **sp, float *f, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (!scan_float(sp, f + i))
+            return i;
+
+    return n;
+}
+
+/*---------------------------------------------------------------------------*/
+
 /*
  * This is a basic OBJ loader.  It is by no means fully compliant with
  * the  OBJ  specification, but  it  works  well  with the  output  of
@@ -729,21 +910,21 @@ static void read_vt(struct s_base *fp, const char *line)
 {
     struct b_texc *tp = fp->tv + inct(fp);
 
-    sscanf(line, "%f %f", tp->u, tp->u + 1);
+    scan_floats(&line, tp->u, 2);
 }
 
 static void read_vn(struct s_base *fp, const char *line)
 {
     struct b_side *sp = fp->sv + incs(fp);
 
-    sscanf(line, "%f %f %f", sp->n, sp->n + 1, sp->n + 2);
+    scan_floats(&line, sp->n, 3);
 }
 
 static void read_v(struct s_base *fp, const char *line)
 {
     struct b_vert *vp = fp->vv + incv(fp);
 
-    sscanf(line, "%f %f %f", vp->p, vp->p + 1, vp->p + 2);
+    scan_floats(&line, vp->p, 3);
 }
 
 static void read_f(struct s_base *fp, const char *line,
@@ -755,13 +936,21 @@ static void read_f(struct s_base *fp, const char *line,
     struct b_offs *oq = fp->ov + (gp->oj = inco(fp));
     struct b_offs *or = fp->ov + (gp->ok = inco(fp));
 
-    char c1;
-    char c2;
+    struct b_offs *ov[3];
+    char c;
+    int i;
+
+    ov[0] = op;
+    ov[1] = oq;
+    ov[2] = or;
+
+    /* Scan "%d%c%d%c%d" three times, stopping where scanf would. */
 
-    sscanf(line, "%d%c%d%c%d %d%c%d%c%d %d%c%d%c%d",
-           &op->vi, &c1, &op->ti, &c2, &op->si,
-           &oq->vi, &c1, &oq->ti, &c2, &oq->si,
-           &or->vi, &c1, &or->ti, &c2, &or->si);
+    for (i = 0; i < 3; i++)
+        if (!scan_int (&line, &ov[i]->vi) || !scan_char(&line, &c, 0) ||
+            !scan_int (&line, &ov[i]->ti) || !scan_char(&line, &c, 0) ||
+            !scan_int (&line, &ov[i]->si))
+            break;
 
     op->vi += (v0 - 1);
     oq->vi += (v0 - 1);
@@ -780,6 +969,7 @@ static void read_obj(struct s_base *fp, const char *name, int mi)
 {
     char line[MAXSTR];
     char mtrl[MAXSTR];
+    struct scan sc;
     fs_file fin;
 
     int v0 = fp->vc;
@@ -788,7 +978,10 @@ static void read_obj(struct s_base *fp, const char *name, int mi)
 
     if ((fin = fs_open(name, "r")))
     {
-        while (fs_gets(line, MAXSTR, fin))
+        scan_init(&sc, fin);
+        fs_close(fin);
+
+        while (scan_gets(line, MAXSTR, &sc))
         {
             if (strncmp(line, "usemtl", 6) == 0)
             {
@@ -806,7 +999,7 @@ static void read_obj(struct s_base *fp, const char *name, int mi)
             else if (strncmp(line, "vn", 2) == 0) read_vn(fp, line + 2);
             else if (strncmp(line, "v",  1) == 0) read_v (fp, line + 1);
         }
-        fs_close(fin);
+        scan_free(&sc);
     }
 }
 
@@ -904,18 +1097,35 @@ static void make_plane(int   pi, float x0, float y0, float      z0,
 #define T_END 4
 #define T_NOP 5
 
-static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
+static int map_plane(const char *buf, float v[3][3], char *key,
+                     float t[5], int *fl)
+{
+    const char *s = buf;
+    char c;
+    int i;
+
+    /* Scan "%c %f %f %f %c " three times, then "%s %f %f %f %f %f %d". */
+
+    for (i = 0; i < 3; i++)
+        if (!scan_char  (&s, &c, i) ||
+             scan_floats(&s, v[i], 3) != 3 ||
+            !scan_char  (&s, &c, 1))
+            return 0;
+
+    return (scan_word  (&s, key) &&
+            scan_floats(&s, t, 5) == 5 &&
+            scan_int   (&s, fl));
+}
+
+static int map_token(struct scan *sp, int pi,
+                     char key[MAXSTR], char val[MAXSTR])
 {
     char buf[MAXSTR];
 
-    if (fs_gets(buf, MAXSTR, fin))
+    if (scan_gets(buf, MAXSTR, sp))
     {
-        char c;
-        float x0, y0, z0;
-        float x1, y1, z1;
-        float x2, y2, z2;
-        float tu, tv, r;
-        float su, sv;
+        float v[3][3];
+        float t[5];
         int fl;
 
         /* Scan the beginning or end of a block. */
@@ -936,20 +1146,12 @@ static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
 
         /* Scan a plane. */
 
-        if (sscanf(buf,
-                   "%c %f %f %f %c "
-                   "%c %f %f %f %c "
-                   "%c %f %f %f %c "
-                   "%s %f %f %f %f %f %d",
-                   &c, &x0, &y0, &z0, &c,
-                   &c, &x1, &y1, &z1, &c,
-                   &c, &x2, &y2, &z2, &c,
-                   key, &tu, &tv, &r, &su, &sv, &fl) == 22)
+        if (map_plane(buf, v, key, t, &fl))
         {
-            make_plane(pi, x0, y0, z0,
-                       x1, y1, z1,
-                       x2, y2, z2,
-                       tu, tv, r, su, sv, fl, key);
+            make_plane(pi, v[0][0], v[0][1], v[0][2],
+                       v[1][0], v[1][1], v[1][2],
+                       v[2][0], v[2][1], v[2][2],
+                       t[0], t[1], t[2], t[3], t[4], fl, key);
             return T_CLP;
         }
 
@@ -964,7 +1166,7 @@ static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
 
 /* Parse a lump from the given file and add it to the solid. */
 
-static void read_lump(struct s_base *fp, fs_file fin)
+static void read_lump(struct s_base *fp, struct scan *sp)
 {
     char k[MAXSTR];
     char v[MAXSTR];
@@ -974,7 +1176,7 @@ static void read_lump(struct s_base *fp, fs_file fin)
 
     lp->s0 = fp->ic;
 
-    while ((t = map_token(fin, fp->sc, k, v)))
+    while ((t = map_token(sp, fp->sc, k, v)))
     {
         if (t == T_CLP)
         {
@@ -1482,7 +1684,7 @@ static void make_ball(struct s_base *fp,
 
 /*---------------------------------------------------------------------------*/
 
-static void read_ent(struct s_base *fp, fs_file fin)
+static void read_ent(struct s_base *fp, struct scan *sp)
 {
     char k[MAXKEY][MAXSTR];
     char v[MAXKEY][MAXSTR];
@@ -1490,7 +1692,7 @@ static void read_ent(struct s_base *fp, fs_file fin)
 
     int l0 = fp->lc;
 
-    while ((t = map_token(fin, -1, k[c], v[c])))
+    while ((t = map_token(sp, -1, k[c], v[c])))
     {
         if (t == T_KEY)
         {
@@ -1498,7 +1700,7 @@ static void read_ent(struct s_base *fp, fs_file fin)
                 i = c;
             c++;
         }
-        if (t == T_BEG) read_lump(fp, fin);
+        if (t == T_BEG) read_lump(fp, sp);
         if (t == T_END) break;
     }
 
@@ -1526,11 +1728,16 @@ static void read_map(struct s_base *fp, fs_file fin)
 {
     char k[MAXSTR];
     char v[MAXSTR];
+    struct scan sc;
     int t;
 
-    while ((t = map_token(fin, -1, k, v)))
+    scan_init(&sc, fin);
+
+    while ((t = map_token(&sc, -1, k, v)))
         if (t == T_BEG)
-            read_ent(fp, fin);
+            read_ent(fp, &sc);
+
+    scan_free(&sc);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -1555,7 +1762,7 @@ static int on_side(const float p[3], const struct b_side *sp)
  * geometry.
  */
 
-static int ok_vert(const struct s_base *fp,
+static int ok_vert(const struct s_base *cp,
                    const struct b_lump *lp, const float p[3])
 {
     float r[3];
@@ -1563,7 +1770,7 @@ static int ok_vert(const struct s_base *fp,
 
     for (i = 0; i < lp->vc; i++)
     {
-        float *q = fp->vv[fp->iv[lp->v0 + i]].p;
+        float *q = cp->vv[cp->iv[lp->v0 + i]].p;
 
         v_sub(r, p, q);
 
@@ -1583,6 +1790,11 @@ static int ok_vert(const struct s_base *fp,
  * and  geoms directly  by clipping  down infinite  line  segments and
  * planes,  but this  would be  more  complex and  prone to  numerical
  * error.
+ *
+ * Each lump is clipped in isolation.  The side planes are read from the
+ * file 'fp', and the resulting elements are written to the scratch file
+ * 'cp', to be appended to the file afterward.  This allows lumps to be
+ * clipped in parallel.
  */
 
 /*
@@ -1590,7 +1802,7 @@ static int ok_vert(const struct s_base *fp,
  * Confirm that this point falls  within the current lump, and that it
  * is unique.  Add it as a vert of the solid.
  */
-static void clip_vert(struct s_base *fp,
+static void clip_vert(const struct s_base *fp, struct s_base *cp,
                       struct b_lump *lp, int si, int sj, int sk)
 {
     float M[16], X[16], I[16];
@@ -1616,13 +1828,13 @@ static void clip_vert(struct s_base *fp,
                 return;
         }
 
-        if (ok_vert(fp, lp, p))
+        if (ok_vert(cp, lp, p))
         {
-            v_cpy(fp->vv[fp->vc].p, p);
+            v_cpy(cp->vv[cp->vc].p, p);
 
-            fp->iv[fp->ic] = fp->vc;
-            inci(fp);
-            incv(fp);
+            cp->iv[cp->ic] = cp->vc;
+            inci(cp);
+            incv(cp);
             lp->vc++;
         }
     }
@@ -1633,33 +1845,33 @@ static void clip_vert(struct s_base *fp,
  * finding a pair of vertices that fall on both planes.  Add it to the
  * solid.
  */
-static void clip_edge(struct s_base *fp,
+static void clip_edge(const struct s_base *fp, struct s_base *cp,
                       struct b_lump *lp, int si, int sj)
 {
     int i, j;
 
     for (i = 1; i < lp->vc; i++)
     {
-        int vi = fp->iv[lp->v0 + i];
+        int vi = cp->iv[lp->v0 + i];
 
-        if (!on_side(fp->vv[vi].p, fp->sv + si) ||
-            !on_side(fp->vv[vi].p, fp->sv + sj))
+        if (!on_side(cp->vv[vi].p, fp->sv + si) ||
+            !on_side(cp->vv[vi].p, fp->sv + sj))
             continue;
 
         for (j = 0; j < i; j++)
         {
-            int vj = fp->iv[lp->v0 + j];
+            int vj = cp->iv[lp->v0 + j];
 
-            if (on_side(fp->vv[vj].p, fp->sv + si) &&
-                on_side(fp->vv[vj].p, fp->sv + sj))
+            if (on_side(cp->vv[vj].p, fp->sv + si) &&
+                on_side(cp->vv[vj].p, fp->sv + sj))
             {
-                fp->ev[fp->ec].vi = vi;
-                fp->ev[fp->ec].vj = vj;
+                cp->ev[cp->ec].vi = vi;
+                cp->ev[cp->ec].vj = vj;
 
-                fp->iv[fp->ic] = fp->ec;
+                cp->iv[cp->ic] = cp->ec;
 
-                inci(fp);
-                ince(fp);
+                inci(cp);
+                ince(cp);
                 lp->ec++;
             }
         }
@@ -1671,7 +1883,7 @@ static void clip_edge(struct s_base *fp,
  * verts to  have a counter-clockwise winding about  the plane normal.
  * Create geoms to tessellate the resulting convex polygon.
  */
-static void clip_geom(struct s_base *fp,
+static void clip_geom(const struct s_base *fp, struct s_base *cp,
                       struct b_lump *lp, int si)
 {
     int   m[256], t[256], d, i, j, n = 0;
@@ -1679,23 +1891,23 @@ static void clip_geom(struct s_base *fp,
     float v[3];
     float w[3];
 
-    struct b_side *sp = fp->sv + si;
+    const struct b_side *sp = fp->sv + si;
 
     /* Find em. */
 
     for (i = 0; i < lp->vc; i++)
     {
-        int vi = fp->iv[lp->v0 + i];
+        int vi = cp->iv[lp->v0 + i];
 
-        if (on_side(fp->vv[vi].p, sp))
+        if (on_side(cp->vv[vi].p, sp))
         {
             m[n] = vi;
-            t[n] = inct(fp);
+            t[n] = inct(cp);
 
-            v_add(v, fp->vv[vi].p, plane_p[si]);
+            v_add(v, cp->vv[vi].p, plane_p[si]);
 
-            fp->tv[t[n]].u[0] = v_dot(v, plane_u[si]);
-            fp->tv[t[n]].u[1] = v_dot(v, plane_v[si]);
+            cp->tv[t[n]].u[0] = v_dot(v, plane_u[si]);
+            cp->tv[t[n]].u[1] = v_dot(v, plane_v[si]);
 
             n++;
         }
@@ -1706,8 +1918,8 @@ static void clip_geom(struct s_base *fp,
     for (i = 1; i < n; i++)
         for (j = i + 1; j < n; j++)
         {
-            v_sub(u, fp->vv[m[i]].p, fp->vv[m[0]].p);
-            v_sub(v, fp->vv[m[j]].p, fp->vv[m[0]].p);
+            v_sub(u, cp->vv[m[i]].p, cp->vv[m[0]].p);
+            v_sub(v, cp->vv[m[j]].p, cp->vv[m[0]].p);
             v_crs(w, u, v);
 
             if (v_dot(w, sp->n) < 0.f)
@@ -1726,13 +1938,13 @@ static void clip_geom(struct s_base *fp,
 
     for (i = 0; i < n - 2; i++)
     {
-        const int gi = incg(fp);
+        const int gi = incg(cp);
 
-        struct b_geom *gp = fp->gv + gi;
+        struct b_geom *gp = cp->gv + gi;
 
-        struct b_offs *op = fp->ov + (gp->oi = inco(fp));
-        struct b_offs *oq = fp->ov + (gp->oj = inco(fp));
-        struct b_offs *or = fp->ov + (gp->ok = inco(fp));
+        struct b_offs *op = cp->ov + (gp->oi = inco(cp));
+        struct b_offs *oq = cp->ov + (gp->oj = inco(cp));
+        struct b_offs *or = cp->ov + (gp->ok = inco(cp));
 
         gp->mi = plane_m[si];
 
@@ -1748,9 +1960,9 @@ static void clip_geom(struct s_base *fp,
         oq->vi = m[i + 1];
         or->vi = m[i + 2];
 
-        fp->iv[fp->ic] = gi;
+        cp->iv[cp->ic] = gi;
         lp->gc++;
-        inci(fp);
+        inci(cp);
     }
 }
 
@@ -1759,36 +1971,44 @@ static void clip_geom(struct s_base *fp,
  * each trio of planes, a new edge  for each pair of planes, and a new
  * set of geom for each visible plane.
  */
-static void clip_lump(struct s_base *fp, struct b_lump *lp)
+static void clip_lump(const struct s_base *fp, struct s_base *cp,
+                      struct b_lump *lp)
 {
     int i, j, k;
 
-    lp->v0 = fp->ic;
+    cp->vc = 0;
+    cp->ec = 0;
+    cp->tc = 0;
+    cp->oc = 0;
+    cp->gc = 0;
+    cp->ic = 0;
+
+    lp->v0 = cp->ic;
     lp->vc = 0;
 
     for (i = 2; i < lp->sc; i++)
         for (j = 1; j < i; j++)
             for (k = 0; k < j; k++)
-                clip_vert(fp, lp,
+                clip_vert(fp, cp, lp,
                           fp->iv[lp->s0 + i],
                           fp->iv[lp->s0 + j],
                           fp->iv[lp->s0 + k]);
 
-    lp->e0 = fp->ic;
+    lp->e0 = cp->ic;
     lp->ec = 0;
 
     for (i = 1; i < lp->sc; i++)
         for (j = 0; j < i; j++)
-            clip_edge(fp, lp,
+            clip_edge(fp, cp, lp,
                       fp->iv[lp->s0 + i],
                       fp->iv[lp->s0 + j]);
 
-    lp->g0 = fp->ic;
+    lp->g0 = cp->ic;
     lp->gc = 0;
 
     for (i = 0; i < lp->sc; i++)
         if (fp->mv[plane_m[fp->iv[lp->s0 + i]]].d[3] > 0.0f)
-            clip_geom(fp, lp,
+            clip_geom(fp, cp, lp,
                       fp->iv[lp->s0 + i]);
 
     for (i = 0; i < lp->sc; i++)
@@ -1796,12 +2016,98 @@ static void clip_lump(struct s_base *fp, struct b_lump *lp)
             lp->fl |= L_DETAIL;
 }
 
+/*
+ * Append the  elements of a clipped lump to the file,  offsetting all
+ * of their scratch indices.
+ */
+static void join_lump(struct s_base *fp, const struct s_base *cp,
+                      struct b_lump *lp)
+{
+    const int v0 = fp->vc;
+    const int e0 = fp->ec;
+    const int t0 = fp->tc;
+    const int o0 = fp->oc;
+    const int g0 = fp->gc;
+    const int i0 = fp->ic;
+
+    int i;
+
+    for (i = 0; i < cp->vc; i++)
+        fp->vv[incv(fp)] = cp->vv[i];
+
+    for (i = 0; i < cp->ec; i++)
+    {
+        struct b_edge *ep = fp->ev + ince(fp);
+
+        ep->vi = cp->ev[i].vi + v0;
+        ep->vj = cp->ev[i].vj + v0;
+    }
+
+    for (i = 0; i < cp->tc; i++)
+        fp->tv[inct(fp)] = cp->tv[i];
+
+    for (i = 0; i < cp->oc; i++)
+    {
+        struct b_offs *op = fp->ov + inco(fp);
+
+        op->ti = cp->ov[i].ti + t0;
+        op->si = cp->ov[i].si;
+        op->vi = cp->ov[i].vi + v0;
+    }
+
+    for (i = 0; i < cp->gc; i++)
+    {
+        struct b_geom *gp = fp->gv + incg(fp);
+
+        gp->mi = cp->gv[i].mi;
+        gp->oi = cp->gv[i].oi + o0;
+        gp->oj = cp->gv[i].oj + o0;
+        gp->ok = cp->gv[i].ok + o0;
+    }
+
+    for (i = 0; i < lp->vc; i++)
+        fp->iv[inci(fp)] = cp->iv[lp->v0 + i] + v0;
+    for (i = 0; i < lp->ec; i++)
+        fp->iv[inci(fp)] = cp->iv[lp->e0 + i] + e0;
+    for (i = 0; i < lp->gc; i++)
+        fp->iv[inci(fp)] = cp->iv[lp->g0 + i] + g0;
+
+    lp->v0 += i0;
+    lp->e0 += i0;
+    lp->g0 += i0;
+}
+
+/*
+ * Clip lumps in parallel, each thread into its own scratch file.  The
+ * results are joined in lump order, so the output does not depend on
+ * the number of threads or on their scheduling.
+ */
 static void clip_file(struct s_base *fp)
 {
     int i;
 
-    for (i = 0; i < fp->lc; i++)
-        clip_lump(fp, fp->lv + i);
+    OMP(omp parallel)
+    {
+        struct s_base c;
+
+        init_file(&c);
+
+        OMP(omp for ordered schedule(dynamic))
+        for (i = 0; i < fp->lc; i++)
+        {
+            struct b_lump l = fp->lv[i];
+
+            clip_lump(fp, &c, &l);
+
+            OMP(omp ordered)
+            {
+                join_lump(fp, &c, &l);
+                fp->lv[i] = l;
+            }
+        }
+
+        sol_free_base(&c);
+    }
 }
 
 /*---------------------------------------------------------------------------*/
@@ -2226,6 +2532,8 @@ struct b_trip
     int mi;
     int si;
     int gi;
+
+    float d;
 };
 
 static int comp_trip(const void *p, const void *q)
@@ -2241,15 +2549,220 @@ static int comp_trip(const void *p, const void *q)
     return 0;
 }
 
+static int comp_trip_d(const void *p, const void *q)
+{
+    const struct b_trip *tp = (const struct b_trip *) p;
+    const struct b_trip *tq = (const struct b_trip *) q;
+
+    if (tp->d > tq->d) return -1;
+    if (tp->d < tq->d) return +1;
+
+    return 0;
+}
+
+/*
+ * Two side normals are smoothed together when the angle between them,
+ * rounded to a thousandth of a degree, does not exceed the smoothing
+ * angle of the material.  Compute the cosine of that limit so that the
+ * test becomes a comparison of dot products.
+ */
+static float smth_cos(float angle)
+{
+    float a = (ROUND(angle * 1000.0f) + 0.5f) / 1000.0f;
+
+    return (a < 180.0f) ? fcosf(V_RAD(a)) : -2.0f;
+}
+
+/*
+ * Test a dot product against the cosine of the smoothing angle.  Note
+ * that the dot product of opposing normals may round to less than -1.
+ * The angle test accepts these,  as their arc cosine is not a number,
+ * but they sort after all others.
+ */
+static int smth_dot(float d, float cosa)
+{
+    return (d > cosa || d < -1.0f);
+}
+
+/*
+ * Store an accumulated normal as a new side and assign it to the merged
+ * triplets i through l - 1.
+ */
+static void smth_side(struct s_base *fp, struct b_trip *T, int i, int l,
+                      const float N[3])
+{
+    int ss = incs(fp), j;
+
+    v_nrm(fp->sv[ss].n, N);
+    fp->sv[ss].d = 0.0f;
+
+    for (j = i; j < l; ++j)
+        T[j].si = ss;
+}
+
+/*
+ * Smooth a set  of triplets sharing vertex and  material.  The leading
+ * triplet  gathers all  triplets with  a similar  side,  and  the most
+ * similar  of the rest leads  the next cluster.  The  normals are then
+ * accumulated in order  of decreasing similarity.  This  is linear for
+ * all but  the accumulation sort,  but it can only reproduce the order
+ * of the exchange sort below  when no two distinct sides are similar
+ * to a leader by exactly the same amount.  Return 0 on such a tie.
+ */
+static int smth_fast(struct s_base *fp, struct b_trip *T, int i, int e,
+                     float cosa)
+{
+    struct b_trip temp;
+    int j, k, l, m;
+
+    for (j = i; j < e; j = l)
+    {
+        const float *Nj = fp->sv[T[j].si].n;
+
+        float N[3];
+        int acc = 0, tie = 0, n = 0;
+
+        /* Rate each triplet by similarity and count the dissimilar. */
+
+        for (k = j + 1; k < e; ++k)
+        {
+            T[k].d = v_dot(fp->sv[T[k].si].n, Nj);
+
+            if (T[k].si != T[j].si && !smth_dot(T[k].d, cosa))
+                n++;
+        }
+
+        /* Move all similar triplets up behind the leader. */
+
+        for (l = k = j + 1; k < e; ++k)
+        {
+            if (T[k].si == T[j].si || T[k].d > cosa ||
+                (T[k].d < -1.0f && n == 0))
+            {
+                temp = T[k];
+                T[k] = T[l];
+                T[l] = temp;
+                l++;
+            }
+        }
+
+        /* Sort them by similarity, as accumulation order matters. */
+
+        qsort(T + j + 1, l - j - 1, sizeof (struct b_trip), comp_trip_d);
+
+        for (k = j + 2; k < l; ++k)
+            if (T[k].d == T[k - 1].d && T[k].si != T[k - 1].si)
+                return 0;
+
+        /* Select the leader of the next cluster. */
+
+        for (m = l, k = l + 1; k < e; ++k)
+            if (T[k].d > T[m].d)
+            {
+                m   = k;
+                tie = 0;
+            }
+            else if (T[k].d == T[m].d && T[k].si != T[m].si)
+                tie = 1;
+
+        if (tie)
+            return 0;
+
+        if (m < e && m > l)
+        {
+            temp = T[m];
+            T[m] = T[l];
+            T[l] = temp;
+        }
+
+        /* Accumulate all similar side normals. */
+
+        v_cpy(N, Nj);
+
+        for (k = j + 1; k < l; ++k)
+            if (T[k].si != T[j].si)
+            {
+                const float *Nk = fp->sv[T[k].si].n;
+
+                v_add(N, N, Nk);
+                acc++;
+            }
+
+        /* If at least two normals have been accumulated... */
+
+        if (acc)
+            smth_side(fp, T, j, l, N);
+    }
+    return 1;
+}
+
+/*
+ * Smooth  a set of  triplets sharing vertex  and material  by sorting
+ * them by similarity to the leading triplet.  This is quadratic in the
+ * size of the set.
+ */
+static void smth_slow(struct s_base *fp, struct b_trip *T, int i, int e,
+                      float cosa)
+{
+    struct b_trip temp;
+    int j, k, l;
+
+    for (; i < e; i = l)
+    {
+        const float *Ni = fp->sv[T[i].si].n;
+
+        float N[3];
+        int acc = 0;
+
+        for (j = i + 1; j < e; ++j)
+            T[j].d = v_dot(fp->sv[T[j].si].n, Ni);
+
+        /* Sort the set by side similarity to the first. */
+
+        for (j = i + 1; j < e; ++j)
+            for (k = j + 1; k < e; ++k)
+                if (T[j].si != T[k].si && T[k].d > T[j].d)
+                {
+                    temp = T[k];
+                    T[k] = T[j];
+                    T[j] = temp;
+                }
+
+        /* Accumulate all similar side normals. */
+
+        v_cpy(N, Ni);
+
+        for (l = i + 1; l < e; ++l)
+            if (T[l].si != T[i].si)
+            {
+                const float *Nl = fp->sv[T[l].si].n;
+
+                if (!smth_dot(T[l].d, cosa))
+                    break;
+
+                v_add(N, N, Nl);
+                acc++;
+            }
+
+        /* If at least two normals have been accumulated... */
+
+        if (acc)
+            smth_side(fp, T, i, l, N);
+    }
+}
+
 static void smth_file(struct s_base *fp)
 {
-    struct b_trip temp, *T;
+    struct b_trip *T, *U;
 
     if (debug_output == 0)
     {
-        if ((T = (struct b_trip *) malloc(fp->gc * 3 * sizeof (struct b_trip))))
+        T = (struct b_trip *) malloc(fp->gc * 3 * sizeof (struct b_trip));
+        U = (struct b_trip *) malloc(fp->gc * 3 * sizeof (struct b_trip));
+
+        if (T && U)
         {
-            int gi, i, j, k, l, c = 0;
+            int gi, i, e, sc, c = 0;
 
             /* Create a list of all non-faceted vertex triplets. */
 
@@ -2282,71 +2795,25 @@ static void smth_file(struct s_base *fp)
 
             /* For each set of triplets sharing vertex index and material... */
 
-            for (i = 0; i < c; i = l)
+            for (i = 0; i < c; i = e)
             {
-                int acc = 0;
-
-                float N[3], angle = fp->mv[T[i].mi].angle;
-                const float   *Ni = fp->sv[T[i].si].n;
-
-                /* Sort the set by side similarity to the first. */
-
-                for (j = i + 1; j < c && (T[j].vi == T[i].vi &&
-                                          T[j].mi == T[i].mi); ++j)
-                {
-                    for (k = j + 1; k < c && (T[k].vi == T[i].vi &&
-                                              T[k].mi == T[i].mi); ++k)
-                    {
-                        const float *Nj = fp->sv[T[j].si].n;
-                        const float *Nk = fp->sv[T[k].si].n;
-
-                        if (T[j].si != T[k].si && v_dot(Nk, Ni) > v_dot(Nj, Ni))
-                        {
-                            temp = T[k];
-                            T[k] = T[j];
-                            T[j] = temp;
-                        }
-                    }
-                }
-
-                /* Accumulate all similar side normals. */
-
-                N[0] = Ni[0];
-                N[1] = Ni[1];
-                N[2] = Ni[2];
-
-                for (l = i + 1; l < c && (T[l].vi == T[i].vi &&
-                                          T[l].mi == T[i].mi); ++l)
-                    if (T[l].si != T[i].si)
-                    {
-                        const float *Nl = fp->sv[T[l].si].n;
-                        float deg = V_DEG(facosf(v_dot(Ni, Nl)));
-
-                        if (ROUND(deg * 1000.0f) > ROUND(angle * 1000.0f))
-                            break;
+                const float cosa = smth_cos(fp->mv[T[i].mi].angle);
 
-                        N[0] += Nl[0];
-                        N[1] += Nl[1];
-                        N[2] += Nl[2];
+                for (e = i + 1; e < c && (T[e].vi == T[i].vi &&
+                                          T[e].mi == T[i].mi); ++e)
+                    ;
 
-                        acc++;
-                    }
+                /* Take the fast path, or back out of it on a tie. */
 
-                /* If at least two normals have been accumulated... */
+                memcpy(U + i, T + i, (e - i) * sizeof (struct b_trip));
+                sc = fp->sc;
 
-                if (acc)
+                if (!smth_fast(fp, T, i, e, cosa))
                 {
-                    /* Store the accumulated normal as a new side. */
-
-                    int ss = incs(fp);
+                    memcpy(T + i, U + i, (e - i) * sizeof (struct b_trip));
+                    fp->sc = sc;
 
-                    v_nrm(fp->sv[ss].n, N);
-                    fp->sv[ss].d = 0.0f;
-
-                    /* Assign the new normal to the merged triplets. */
-
-                    for (j = i; j < l; ++j)
-                        T[j].si = ss;
+                    smth_slow(fp, T, i, e, cosa);
                 }
             }
 
@@ -2363,10 +2830,11 @@ static void smth_file(struct s_base *fp)
                 if (oq->vi == T[i].vi) oq->si = T[i].si;
                 if (or->vi == T[i].vi) or->si = T[i].si;
             }
-
-            free(T);
         }
 
+        free(U);
+        free(T);
+
         uniq_side(fp);
         uniq_offs(fp);
     }
@@ -2684,6 +3152,409 @@ static void node_file(struct s_base *fp)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Reorder the triangles of  a mesh for the post-transform vertex cache
+ * using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation", and the
+ * vertices to match the order in which they are first used.  With the
+ * overdraw option, cache-coherent clusters  of triangles are then sorted
+ * so that those facing outward from the middle of the mesh come first.
+ * Blended meshes keep their order, as it determines their appearance.
+ */
+
+#define MESH_LRU  32
+#define MESH_FIFO 16
+
+static int mesh_miss_yc = 0;
+static int mesh_miss_qc = 0;
+static int mesh_miss_c0 = 0;
+static int mesh_miss_c1 = 0;
+
+static int mesh_miss(const struct b_elem *qv, int qc, int yc, int *yt)
+{
+    int qi, i, c = 0;
+
+    /* Count the misses of a FIFO vertex cache. yt notes insertion times. */
+
+    for (i = 0; i < yc; i++)
+        yt[i] = -MESH_FIFO - 1;
+
+    for (qi = 0; qi < qc; qi++)
+    {
+        const int y[3] = { qv[qi].yi, qv[qi].yj, qv[qi].yk };
+
+        for (i = 0; i < 3; i++)
+            if (c - yt[y[i]] > MESH_FIFO)
+                yt[y[i]] = c++;
+    }
+    return c;
+}
+
+static float mesh_score(int cp, int n)
+{
+    float s = 0.0f;
+
+    if (n == 0)
+        return -1.0f;
+
+    if (cp >= 0)
+    {
+        if (cp < 3)
+            s = 0.75f;
+        else
+            s = powf(1.0f - (float) (cp - 3) / (MESH_LRU - 3), 1.5f);
+    }
+    return s + 2.0f / sqrtf((float) n);
+}
+
+static void mesh_lru(const struct b_elem *qv, int qc, int yc, int *qo)
+{
+    int *tn = (int *) calloc(yc, sizeof (int));
+    int *t0 = (int *) calloc(yc, sizeof (int));
+    int *tl = (int *) calloc(qc * 3, sizeof (int));
+    int *cp = (int *) calloc(yc, sizeof (int));
+    int *qd = (int *) calloc(qc, sizeof (int));
+
+    float *ys = (float *) calloc(yc, sizeof (float));
+    float *qs = (float *) calloc(qc, sizeof (float));
+
+    int lru[MESH_LRU + 3];
+    int lc = 0;
+
+    int qi, yi, i, j, n, best = -1;
+
+    if (!tn || !t0 || !tl || !cp || !qd || !ys || !qs)
+    {
+        ERROR("mesh allocation failure\n");
+        exit(1);
+    }
+
+    /* Build vertex-triangle adjacency. */
+
+    for (qi = 0; qi < qc; qi++)
+    {
+        tn[qv[qi].yi]++;
+        tn[qv[qi].yj]++;
+        tn[qv[qi].yk]++;
+    }
+    for (yi = 1; yi < yc; yi++)
+        t0[yi] = t0[yi - 1] + tn[yi - 1];
+
+    memset(tn, 0, yc * sizeof (int));
+
+    for (qi = 0; qi < qc; qi++)
+    {
+        tl[t0[qv[qi].yi] + tn[qv[qi].yi]++] = qi;
+        tl[t0[qv[qi].yj] + tn[qv[qi].yj]++] = qi;
+        tl[t0[qv[qi].yk] + tn[qv[qi].yk]++] = qi;
+    }
+
+    /* Score everything with an empty cache. */
+
+    for (yi = 0; yi < yc; yi++)
+    {
+        cp[yi] = -1;
+        ys[yi] = mesh_score(-1, tn[yi]);
+    }
+    for (qi = 0; qi < qc; qi++)
+        qs[qi] = ys[qv[qi].yi] + ys[qv[qi].yj] + ys[qv[qi].yk];
+
+    for (n = 0; n < qc; n++)
+    {
+        float bs = -1.0f;
+
+        /* Fall back on a full search when the cache gives no candidate. */
+
+        if (best < 0)
+            for (qi = 0; qi < qc; qi++)
+                if (!qd[qi] && qs[qi] > bs)
+                {
+                    bs   = qs[qi];
+                    best = qi;
+                }
+
+        qo[n]    = best;
+        qd[best] = 1;
+
+        /* Detach the triangle from its vertices and push them to the cache. */
+
+        {
+            const int y[3] = { qv[best].yi, qv[best].yj, qv[best].yk };
+            int nv[MESH_LRU + 3];
+            int nc = 0;
+
+            for (i = 0; i < 3; i++)
+            {
+                int *tv = tl + t0[y[i]];
+
+                for (j = 0; j < tn[y[i]]; j++)
+                    if (tv[j] == best)
+                    {
+                        tv[j] = tv[--tn[y[i]]];
+                        break;
+                    }
+
+                nv[nc++] = y[i];
+            }
+
+            for (i = 0; i < lc; i++)
+                if (lru[i] != y[0] && lru[i] != y[1] && lru[i] != y[2])
+                    nv[nc++] = lru[i];
+
+            for (i = 0; i < nc; i++)
+                cp[nv[i]] = (i < MESH_LRU) ? i : -1;
+
+            lc = MIN(nc, MESH_LRU);
+            memcpy(lru, nv, nc * sizeof (int));
+
+            /* Rescore the affected vertices and triangles. */
+
+            for (i = 0; i < nc; i++)
+                ys[nv[i]] = mesh_score(cp[nv[i]], tn[nv[i]]);
+
+            best = -1;
+            bs   = -1.0f;
+
+            for (i = 0; i < nc; i++)
+                for (j = 0; j < tn[nv[i]]; j++)
+                {
+                    qi = tl[t0[nv[i]] + j];
+
+                    qs[qi] = ys[qv[qi].yi] + ys[qv[qi].yj] + ys[qv[qi].yk];
+
+                    if (qs[qi] > bs)
+                    {
+                        bs   = qs[qi];
+                        best = qi;
+                    }
+                }
+        }
+    }
+
+    free(qs);
+    free(ys);
+    free(qd);
+    free(cp);
+    free(tl);
+    free(t0);
+    free(tn);
+}
+
+struct mesh_clus
+{
+    float k;
+    int   q0;
+    int   qc;
+};
+
+static int comp_clus(const void *p, const void *q)
+{
+    const struct mesh_clus *a = (const struct mesh_clus *) p;
+    const struct mesh_clus *b = (const struct mesh_clus *) q;
+
+    if (a->k > b->k) return -1;
+    if (a->k < b->k) return +1;
+
+    return a->q0 - b->q0;
+}
+
+static void mesh_clus(const struct b_attr *yv, const struct b_elem *qv,
+                      int qc, int yc, int *qo, int *yt)
+{
+    struct mesh_clus *cv;
+    int *qp;
+    int qi, i, cc = 0, c = 0;
+    float C[3] = { 0.0f, 0.0f, 0.0f };
+
+    cv = (struct mesh_clus *) calloc(qc, sizeof (*cv));
+    qp = (int *)              calloc(qc, sizeof (int));
+
+    if (!cv || !qp)
+    {
+        ERROR("mesh allocation failure\n");
+        exit(1);
+    }
+
+    for (i = 0; i < yc; i++)
+        v_add(C, C, yv[i].p);
+
+    v_scl(C, C, 1.0f / yc);
+
+    /* Start a new cluster wherever the order misses on all vertices. */
+
+    for (i = 0; i < yc; i++)
+        yt[i] = -MESH_FIFO - 1;
+
+    for (qi = 0; qi < qc; qi++)
+    {
+        const struct b_elem *qq = qv + qo[qi];
+        const int y[3] = { qq->yi, qq->yj, qq->yk };
+        int m = 0;
+
+        for (i = 0; i < 3; i++)
+            if (c - yt[y[i]] > MESH_FIFO)
+            {
+                yt[y[i]] = c++;
+                m++;
+            }
+
+        if (m == 3 || cc == 0)
+            cv[cc++].q0 = qi;
+
+        cv[cc - 1].qc++;
+    }
+
+    /* Key each cluster by its area-weighted facing away from the middle. */
+
+    for (i = 0; i < cc; i++)
+    {
+        float n[3] = { 0.0f, 0.0f, 0.0f };
+        float p[3] = { 0.0f, 0.0f, 0.0f };
+        float a = 0.0f;
+
+        for (qi = cv[i].q0; qi < cv[i].q0 + cv[i].qc; qi++)
+        {
+            const struct b_elem *qq = qv + qo[qi];
+            float u[3], v[3], w[3], m[3], l;
+
+            v_sub(u, yv[qq->yj].p, yv[qq->yi].p);
+            v_sub(v, yv[qq->yk].p, yv[qq->yi].p);
+            v_crs(w, u, v);
+
+            v_add(m, yv[qq->yi].p, yv[qq->yj].p);
+            v_add(m, m,            yv[qq->yk].p);
+
+            l = v_len(w);
+
+            v_add(n, n, w);
+            v_mad(p, p, m, l / 3.0f);
+            a += l;
+        }
+
+        if (a > 0.0f)
+        {
+            v_scl(p, p, 1.0f / a);
+            v_sub(p, p, C);
+            v_nrm(n, n);
+            cv[i].k = v_dot(p, n);
+        }
+    }
+
+    qsort(cv, cc, sizeof (*cv), comp_clus);
+
+    for (i = 0, c = 0; i < cc; i++)
+        for (qi = cv[i].q0; qi < cv[i].q0 + cv[i].qc; qi++)
+            qp[c++] = qo[qi];
+
+    memcpy(qo, qp, qc * sizeof (int));
+
+    free(qp);
+    free(cv);
+}
+
+static void mesh_sort(struct s_base *fp, struct b_mesh *kp)
+{
+    struct b_attr *yv = fp->yv + kp->y0;
+    struct b_elem *qv = fp->qv + kp->q0;
+
+    struct b_attr *yw;
+    struct b_elem *qw;
+
+    int *qo;
+    int *yo;
+    int qi, yi, c0, c1, n = 0;
+
+    const int fl = fp->mv[kp->mi].fl;
+
+    mesh_miss_yc += kp->yc;
+    mesh_miss_qc += kp->qc;
+
+    yw = (struct b_attr *) calloc(kp->yc, sizeof (*yw));
+    qw = (struct b_elem *) calloc(kp->qc, sizeof (*qw));
+    qo = (int *)           calloc(kp->qc, sizeof (int));
+    yo = (int *)           calloc(kp->yc, sizeof (int));
+
+    if (!yw || !qw || !qo || !yo)
+    {
+        ERROR("mesh allocation failure\n");
+        exit(1);
+    }
+
+    c0 = c1 = mesh_miss(qv, kp->qc, kp->yc, yo);
+
+    if ((fl & (M_TRANSPARENT | M_ADDITIVE | M_DECAL | M_PARTICLE)) == 0)
+    {
+        /* Order triangles, optionally cluster them, and apply the order. */
+
+        mesh_lru(qv, kp->qc, kp->yc, qo);
+
+        if (overdraw_sort)
+            mesh_clus(yv, qv, kp->qc, kp->yc, qo, yo);
+
+        for (qi = 0; qi < kp->qc; qi++)
+            qw[qi] = qv[qo[qi]];
+
+        /* Number vertices in order of first use. */
+
+        for (yi = 0; yi < kp->yc; yi++)
+            yo[yi] = -1;
+
+        for (qi = 0; qi < kp->qc; qi++)
+        {
+            int *y[3] = { &qw[qi].yi, &qw[qi].yj, &qw[qi].yk }, i;
+
+            for (i = 0; i < 3; i++)
+            {
+                if (yo[*y[i]] == -1)
+                {
+                    yw[n]     = yv[*y[i]];
+                    yo[*y[i]] = n++;
+                }
+                *y[i] = yo[*y[i]];
+            }
+        }
+
+        /* Keep the new order unless it is a plain regression. */
+
+        c1 = mesh_miss(qw, kp->qc, kp->yc, yo);
+
+        if (c1 < c0 || overdraw_sort)
+        {
+            memcpy(yv, yw, kp->yc * sizeof (*yv));
+            memcpy(qv, qw, kp->qc * sizeof (*qv));
+        }
+        else c1 = c0;
+    }
+
+    mesh_miss_c0 += c0;
+    mesh_miss_c1 += c1;
+
+    free(yo);
+    free(qo);
+    free(qw);
+    free(yw);
+}
+
+/*
+ * Precompile the render meshes that the draw loader would otherwise
+ * assemble at load time, and optimise their order.
+ */
+
+static void mesh_file(struct s_base *fp)
+{
+    int ki;
+
+    if (!sol_mesh_base(fp))
+    {
+        ERROR("mesh allocation failure\n");
+        exit(1);
+    }
+
+    for (ki = 0; ki < fp->kc; ki++)
+        mesh_sort(fp, fp->kv + ki);
+}
+
+/*---------------------------------------------------------------------------*/
+
 struct dump_stats
 {
     size_t off;
@@ -2716,7 +3587,10 @@ static struct dump_stats stats[] = {
     { offsetof (struct s_base, uc), "ball", "balls" },
     { offsetof (struct s_base, ac), "char", "chars" },
     { offsetof (struct s_base, dc), "dict", "dicts" },
-    { offsetof (struct s_base, ic), "indx", "indices" }
+    { offsetof (struct s_base, ic), "indx", "indices" },
+    { offsetof (struct s_base, kc), "mesh", "meshes" },
+    { offsetof (struct s_base, yc), "attr", "mesh vertices" },
+    { offsetof (struct s_base, qc), "elem", "mesh triangles" }
 };
 
 static void dump_init(struct s_base *fp)
@@ -2770,13 +3644,19 @@ static void dump_file(struct s_base *p, const char *name, double t)
         printf("name,n,c,t,");
 
         for (i = 0; i < ARRAYSIZE(stats); i++)
-            printf("%s%s", stats[i].name, (i + 1 < ARRAYSIZE(stats) ?
-                                           "," : "\n"));
+            printf("%s,", stats[i].name);
+
+        printf("acmr0,acmr1,atvr0,atvr1\n");
         printf("%s,%d,%d,%.3f,", name, n, c, t);
 
         for (i = 0; i < ARRAYSIZE(stats); i++)
-            printf("%d%s", *stats[i].ptr, (i + 1 < ARRAYSIZE(stats) ?
-                                           "," : "\n"));
+            printf("%d,", *stats[i].ptr);
+
+        printf("%.3f,%.3f,%.3f,%.3f\n",
+               (double) mesh_miss_c0 / MAX(mesh_miss_qc, 1),
+               (double) mesh_miss_c1 / MAX(mesh_miss_qc, 1),
+               (double) mesh_miss_c0 / MAX(mesh_miss_yc, 1),
+               (double) mesh_miss_c1 / MAX(mesh_miss_yc, 1));
     }
     else
     {
@@ -2798,6 +3678,13 @@ static void dump_file(struct s_base *p, const char *name, double t)
                 printf("\n");
             }
         }
+
+        if (mesh_miss_qc)
+            printf("ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n",
+                   (double) mesh_miss_c0 / mesh_miss_qc,
+                   (double) mesh_miss_c1 / mesh_miss_qc,
+                   (double) mesh_miss_c0 / mesh_miss_yc,
+                   (double) mesh_miss_c1 / mesh_miss_yc);
     }
 }
 
@@ -2828,6 +3715,8 @@ int main(int argc, char *argv[])
         {
             if (strcmp(argv[argi], "--debug") == 0) debug_output = 1;
             if (strcmp(argv[argi], "--csv")   == 0)   csv_output = 1;
+            if (strcmp(argv[argi], "--no-mesh") == 0) mesh_output = 0;
+            if (strcmp(argv[argi], "--overdraw") == 0) overdraw_sort = 1;
 #if ENABLE_RADIANT_CONSOLE
             if (strcmp(argv[argi], "--bcast") == 0) bcast_init();
 #endif
@@ -2874,6 +3763,9 @@ int main(int argc, char *argv[])
                 sort_file(&f);
                 node_file(&f);
 
+                if (mesh_output)
+                    mesh_file(&f);
+
                 sol_stor_base(&f, base_name(dst));
             }
             gettimeofday(&time1, 0);
@@ -2891,7 +3783,8 @@ int main(int argc, char *argv[])
 #endif
 
     }
-    else fprintf(stderr, "Usage: %s <map> <data> [--debug] [--csv]\n", argv[0]);
+    else fprintf(stderr, "Usage: %s <map> <data> [--debug] [--csv] "
+                         "[--no-mesh] [--overdraw]\n", argv[0]);
 
     return 0;
 }
@@ -19,6 +19,8 @@
 #include "array.h"
 #include "common.h"
 #include "image.h"
+#include "image_async.h"
+#include "config.h"
 #include "lang.h"
 
 /*
@@ -44,6 +46,16 @@
  *
  * Obviously, features that require geometry recomputation, such as
  * "angle" normal smoothing feature, are not handled by the reloader.
+ *
+ * Materials are found by texture file name. Names are interned in a
+ * string table, hashed, and each name records the material last cached
+ * under it. Materials refer to their name by its index in the table.
+ *
+ * Textures outlive their materials. A material that is no longer
+ * referenced keeps its texture, and is found again by name, until the
+ * textures of all materials exceed the configured budget. Then the
+ * least recently released are freed. A kept material takes its other
+ * properties anew from the SOL that brings it back.
  */
 
 static Array mtrls;
@@ -59,6 +71,132 @@ static struct b_mtrl default_base_mtrl =
 
 int default_mtrl;
 
+struct mtrl_count mtrl_total;
+
+static unsigned int mtrl_tick;
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Interned material names.
+ */
+
+struct mtrl_name
+{
+    char        *str;
+    unsigned int key;                      /* Hash of the string             */
+    int          mi;                       /* Material last cached, or -1    */
+};
+
+static struct mtrl_name *namev;            /* Names, by handle               */
+static int               namec;
+static int               namem;
+
+static int              *hashv;            /* Name handles plus one, by hash */
+static int               hashm;
+
+static unsigned int name_key(const char *str)
+{
+    unsigned int x = 2166136261u;
+
+    while (*str)
+        x = (x ^ (unsigned char) *str++) * 16777619u;
+
+    return x;
+}
+
+static int *name_slot(const char *str, unsigned int key)
+{
+    unsigned int i = key & (hashm - 1);
+
+    while (hashv[i] && (namev[hashv[i] - 1].key != key ||
+                        strcmp(namev[hashv[i] - 1].str, str) != 0))
+        i = (i + 1) & (hashm - 1);
+
+    return hashv + i;
+}
+
+/*
+ * Find the handle of a name, or -1 if it was never interned.
+ */
+static int name_find(const char *str)
+{
+    if (hashm == 0)
+        return -1;
+
+    return *name_slot(str, name_key(str)) - 1;
+}
+
+/*
+ * Find the handle of a name, adding the name if necessary.
+ */
+static int name_intern(const char *str)
+{
+    unsigned int key = name_key(str);
+    int *sp;
+
+    /* Keep the hash table at most half full. */
+
+    if (namec * 2 >= hashm)
+    {
+        int m = hashm ? hashm * 2 : 256;
+        int *v, i;
+
+        if (!(v = calloc(m, sizeof (*v))))
+            return -1;
+
+        free(hashv);
+
+        hashv = v;
+        hashm = m;
+
+        for (i = 0; i < namec; i++)
+            *name_slot(namev[i].str, namev[i].key) = i + 1;
+    }
+
+    if (*(sp = name_slot(str, key)) == 0)
+    {
+        if (namec == namem)
+        {
+            int m = namem ? namem * 2 : 256;
+            struct mtrl_name *v;
+
+            if (!(v = realloc(namev, m * sizeof (*v))))
+                return -1;
+
+            namev = v;
+            namem = m;
+        }
+
+        if (!(namev[namec].str = strdup(str)))
+            return -1;
+
+        namev[namec].key = key;
+        namev[namec].mi  = -1;
+
+        *sp = ++namec;
+    }
+
+    return *sp - 1;
+}
+
+static void name_free(void)
+{
+    int i;
+
+    for (i = 0; i < namec; i++)
+        free(namev[i].str);
+
+    free(namev);
+    free(hashv);
+
+    namev = NULL;
+    hashv = NULL;
+    namec = 0;
+    namem = 0;
+    hashm = 0;
+}
+
 /*---------------------------------------------------------------------------*/
 
 /*
@@ -66,37 +204,65 @@ int default_mtrl;
  */
 static int find_mtrl(const char *name)
 {
-    int i, c = array_len(mtrls);
+    int ni, mi;
 
-    for (i = 0; i < c; i++)
+    if ((ni = name_find(name)) >= 0 && (mi = namev[ni].mi) >= 0)
     {
-        struct mtrl *mp = array_get(mtrls, i);
+        struct mtrl *mp = array_get(mtrls, mi);
 
-        if (mp->refc > 0 && strcmp(name, mp->base.f) == 0)
-            return i;
+        /* The slot may since have been freed or reused. */
+
+        if ((mp->refc > 0 || mp->o) && mp->name == ni)
+            return mi;
     }
     return -1;
 }
 
 /*
- * Load a material texture.
+ * Load a material texture.  With an upload budget, the texture is
+ * decoded in the background and a placeholder is returned at once.
  */
 static GLuint find_texture(const char *name)
 {
-    char path[MAXSTR];
+    char path[ARRAYSIZE(tex_paths)][MAXSTR];
+    const char *paths[ARRAYSIZE(tex_paths)];
     GLuint o;
     int i;
 
     for (i = 0; i < ARRAYSIZE(tex_paths); i++)
     {
-        CONCAT_PATH(path, &tex_paths[i], name);
+        CONCAT_PATH(path[i], &tex_paths[i], name);
+        paths[i] = path[i];
+    }
 
-        if ((o = make_image_from_file(path, IF_MIPMAP)))
+    if (config_get_d(CONFIG_UPLOAD_BUDGET) > 0)
+        if ((o = image_async_load(paths, ARRAYSIZE(tex_paths),
+                                    IF_MIPMAP | IF_CACHE)))
             return o;
-    }
+
+    for (i = 0; i < ARRAYSIZE(tex_paths); i++)
+        if ((o = make_image_from_file(paths[i], IF_MIPMAP | IF_CACHE)))
+            return o;
+
     return 0;
 }
 
+/*
+ * Set the bound texture to clamp or repeat based on material type.
+ */
+static void wrap_mtrl_objects(const struct mtrl *mp)
+{
+    if (mp->base.fl & M_CLAMP_S)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+
+    if (mp->base.fl & M_CLAMP_T)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
 /*
  * Load GL resources of an initialized material.
  */
@@ -107,21 +273,14 @@ static void load_mtrl_objects(struct mtrl *mp)
     if (mp->o)
         return;
 
-    /* Load the texture. */
+    /* Load the texture and count it toward the budget. */
 
-    if ((mp->o = find_texture(_(mp->base.f))))
+    if ((mp->o = find_texture(_(mtrl_name(mp)))))
     {
-        /* Set the texture to clamp or repeat based on material type. */
-
-        if (mp->base.fl & M_CLAMP_S)
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        else
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        mtrl_total.loads++;
 
-        if (mp->base.fl & M_CLAMP_T)
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        else
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        image_set_tally(mp->o, 1);
+        wrap_mtrl_objects(mp);
     }
 }
 
@@ -132,6 +291,8 @@ static void free_mtrl_objects(struct mtrl *mp)
 {
     if (mp->o)
     {
+        image_async_drop(mp->o);
+        image_set_tally(mp->o, 0);
         glDeleteTextures(1, &mp->o);
 
         mp->o = 0;
@@ -139,13 +300,24 @@ static void free_mtrl_objects(struct mtrl *mp)
 }
 
 /*
- * Load a material from a base material.
+ * Copy the properties of a base material.
  */
-static void load_mtrl(struct mtrl *mp, const struct b_mtrl *base)
+static void load_mtrl_base(struct mtrl *mp, const struct b_mtrl *base)
 {
-    /* Copy the base material. */
+    /* Copy the base material, interning its texture name. */
+
+    memcpy(mp->base.d, base->d, sizeof (base->d));
+    memcpy(mp->base.a, base->a, sizeof (base->a));
+    memcpy(mp->base.s, base->s, sizeof (base->s));
+    memcpy(mp->base.e, base->e, sizeof (base->e));
+    memcpy(mp->base.h, base->h, sizeof (base->h));
 
-    memcpy(&mp->base, base, sizeof (struct b_mtrl));
+    mp->base.angle      = base->angle;
+    mp->base.fl         = base->fl;
+    mp->base.alpha_func = base->alpha_func;
+    mp->base.alpha_ref  = base->alpha_ref;
+
+    mp->name = name_intern(base->f);
 
     /* Cache the 32-bit material values for quick comparison. */
 
@@ -154,9 +326,14 @@ static void load_mtrl(struct mtrl *mp, const struct b_mtrl *base)
     mp->s = touint(base->s);
     mp->e = touint(base->e);
     mp->h = tobyte(base->h[0]);
+}
 
-    /* Load GL resources. */
-
+/*
+ * Load a material from a base material.
+ */
+static void load_mtrl(struct mtrl *mp, const struct b_mtrl *base)
+{
+    load_mtrl_base(mp, base);
     load_mtrl_objects(mp);
 }
 
@@ -168,6 +345,56 @@ static void free_mtrl(struct mtrl *mp)
     free_mtrl_objects(mp);
 }
 
+/*
+ * Return the memory of all loaded material textures.
+ */
+int mtrl_resident(void)
+{
+    return image_get_tally();
+}
+
+/*
+ * Free the least recently released textures until all textures fit
+ * the budget.  Textures in use are never freed.
+ */
+static void mtrl_trim(void)
+{
+    int n = mtrl_resident();
+    int m = config_get_d(CONFIG_TEXTURE_BUDGET) * 1024 * 1024;
+
+    while (n > m)
+    {
+        struct mtrl *lp = NULL;
+
+        int i, c = array_len(mtrls);
+
+        for (i = 0; i < c; i++)
+        {
+            struct mtrl *mp = array_get(mtrls, i);
+
+            if (mp->refc == 0 && mp->o && (!lp || mp->tick < lp->tick))
+                lp = mp;
+        }
+
+        if (lp == NULL)
+            break;
+
+        n -= image_get_bytes(lp->o);
+
+        free_mtrl(lp);
+        mtrl_total.evicts++;
+    }
+}
+
+/*
+ * Make the given material the one found by its name.
+ */
+static void name_mtrl(const struct mtrl *mp, int mi)
+{
+    if (mp->name >= 0)
+        namev[mp->name].mi = mi;
+}
+
 /*
  * Cache a single material.
  */
@@ -187,10 +414,12 @@ int mtrl_cache(const struct b_mtrl *base)
         {
             mp = array_get(mtrls, i);
 
-            if (mp->refc == 0)
+            if (mp->refc == 0 && mp->o == 0)
             {
                 load_mtrl(mp, base);
                 mp->refc++;
+                name_mtrl(mp, i);
+                mtrl_trim();
                 return i;
             }
         }
@@ -202,12 +431,35 @@ int mtrl_cache(const struct b_mtrl *base)
             memset(mp, 0, sizeof (*mp));
             load_mtrl(mp, base);
             mp->refc++;
+            name_mtrl(mp, array_len(mtrls) - 1);
+            mtrl_trim();
             return array_len(mtrls) - 1;
         }
     }
     else
     {
         mp = array_get(mtrls, mi);
+
+        /*
+         * Take back a texture kept from an earlier level, with this SOL's
+         * properties.  Only the texture is reused.
+         */
+
+        if (mp->refc == 0)
+        {
+            int fl = mp->base.fl;
+
+            load_mtrl_base(mp, base);
+
+            if ((fl ^ mp->base.fl) & (M_CLAMP_S | M_CLAMP_T))
+            {
+                glBindTexture(GL_TEXTURE_2D, mp->o);
+                wrap_mtrl_objects(mp);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+            mtrl_total.hits++;
+        }
+
         mp->refc++;
     }
 
@@ -227,8 +479,17 @@ void mtrl_free(int mi)
         {
             mp->refc--;
 
+            /* Keep the texture for later, if the budget allows. */
+
             if (mp->refc == 0)
-                free_mtrl(mp);
+            {
+                if (config_get_d(CONFIG_TEXTURE_BUDGET) > 0)
+                {
+                    mp->tick = ++mtrl_tick;
+                    mtrl_trim();
+                }
+                else free_mtrl(mp);
+            }
         }
     }
 }
@@ -241,6 +502,14 @@ struct mtrl *mtrl_get(int mi)
     return mtrls ? array_get(mtrls, mi) : NULL;
 }
 
+/*
+ * Obtain the texture file name of a material.
+ */
+const char *mtrl_name(const struct mtrl *mp)
+{
+    return (mp->name >= 0 && mp->name < namec) ? namev[mp->name].str : "";
+}
+
 /*
  * Cache SOL materials.
  */
@@ -296,11 +565,16 @@ void mtrl_reload(void)
 
             /* Read the material specification. */
 
-            if (mp->refc > 0 && mtrl_read(&base, mp->base.f))
+            if (mp->refc > 0 && mtrl_read(&base, mtrl_name(mp)))
             {
                 free_mtrl(mp);
                 load_mtrl(mp, &base);
             }
+
+            /* Textures kept for later will be loaded anew. */
+
+            else if (mp->refc == 0)
+                free_mtrl(mp);
         }
     }
 }
@@ -322,19 +596,15 @@ void mtrl_load_objects(void)
 }
 
 /*
- * Delete GL resources of all materials.
+ * Delete GL resources of all materials, including textures kept for
+ * later.
  */
 void mtrl_free_objects(void)
 {
     int i, c = array_len(mtrls);
 
     for (i = 0; i < c; i++)
-    {
-        struct mtrl *mp = array_get(mtrls, i);
-
-        if (mp->refc > 0)
-            free_mtrl_objects(mp);
-    }
+        free_mtrl_objects(array_get(mtrls, i));
 }
 
 /*
@@ -344,6 +614,8 @@ void mtrl_init(void)
 {
     mtrl_quit();
 
+    image_async_init();
+
     if ((mtrls = array_new(sizeof (struct mtrl))))
     {
         /* Cache the default material at index 0. */
@@ -357,6 +629,8 @@ void mtrl_init(void)
  */
 void mtrl_quit(void)
 {
+    image_async_quit();
+
     if (mtrls)
     {
         int i, c = array_len(mtrls);
@@ -367,6 +641,8 @@ void mtrl_quit(void)
         array_free(mtrls);
         mtrls = NULL;
     }
+
+    name_free();
 }
 /*---------------------------------------------------------------------------*/
 
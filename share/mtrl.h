@@ -13,9 +13,31 @@
                              tobyte((v)[2]) << 16 | \
                              tobyte((v)[3]) << 24))
 
+/*
+ * Material properties.  These follow struct b_mtrl, but the texture
+ * file name is interned by the material cache rather than stored.
+ */
+
+struct mtrl_base
+{
+    float d[4];                            /* diffuse color                  */
+    float a[4];                            /* ambient color                  */
+    float s[4];                            /* specular color                 */
+    float e[4];                            /* emission color                 */
+    float h[1];                            /* specular exponent              */
+    float angle;
+
+    int fl;                                /* material flags                 */
+
+    int   alpha_func;                      /* comparison function            */
+    float alpha_ref;                       /* reference value                */
+};
+
 struct mtrl
 {
-    struct b_mtrl base;
+    struct mtrl_base base;
+
+    int    name;                           /* Interned texture file name     */
 
     GLuint d;                              /* 32-bit diffuse color cache     */
     GLuint a;                              /* 32-bit ambient color cache     */
@@ -25,8 +47,22 @@ struct mtrl
     GLuint o;                              /* OpenGL texture object          */
 
     unsigned int refc;
+    unsigned int tick;                     /* Time of last release           */
 };
 
+/*
+ * Texture residency counters, summed across all levels.
+ */
+
+struct mtrl_count
+{
+    int hits;                              /* Textures kept from before      */
+    int loads;                             /* Textures loaded                */
+    int evicts;                            /* Textures released over budget  */
+};
+
+extern struct mtrl_count mtrl_total;
+
 extern int default_mtrl;
 
 void mtrl_init(void);
@@ -36,6 +72,7 @@ int  mtrl_cache(const struct b_mtrl *);
 void mtrl_free (int);
 
 struct mtrl *mtrl_get(int);
+const char  *mtrl_name(const struct mtrl *);
 
 void mtrl_cache_sol(struct s_base *);
 void mtrl_free_sol (struct s_base *);
@@ -45,6 +82,8 @@ void mtrl_free_objects(void);
 
 void mtrl_reload(void);
 
+int  mtrl_resident(void);
+
 /*---------------------------------------------------------------------------*/
 
 GLenum mtrl_func(int);
@@ -17,6 +17,14 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PART_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PART_NEON 1
+#endif
+
 #include "config.h"
 #include "glext.h"
 #include "part.h"
@@ -31,9 +39,15 @@
 #define PARTICLEVBO 1
 */
 
+/*
+ * Live particles are packed at the front of the arrays, and a dying one is
+ * replaced by the last. Simulation state is kept one array per axis so that
+ * the integration loops run over contiguous floats.
+ */
+
 struct part_vary
 {
-    GLfloat v[3];             /* Velocity                                    */
+    GLfloat v[3][PART_MAX_COIN];  /* Velocity                                */
 };
 
 struct part_draw
@@ -43,9 +57,11 @@ struct part_draw
     GLfloat t;                /* Time until death. Doubles as opacity.       */
 };
 
-static struct part_vary coin_vary[PART_MAX_COIN];
+static struct part_vary coin_vary;
 static struct part_draw coin_draw[PART_MAX_COIN];
 
+static int coin_c;
+
 static GLuint coin_vbo;
 
 /*---------------------------------------------------------------------------*/
@@ -77,18 +93,18 @@ static float rnd(float l, float h)
 
 struct part_lerp
 {
-    float p[2][3];
+    float p[2][3][PART_MAX_COIN];
 };
 
-static struct part_lerp part_lerp_coin[PART_MAX_COIN];
+static struct part_lerp part_lerp_coin;
 
 void part_lerp_copy(void)
 {
-    int i;
+    int k;
 
-    for (i = 0; i < PART_MAX_COIN; i++)
-        v_cpy(part_lerp_coin[i].p[PREV],
-              part_lerp_coin[i].p[CURR]);
+    for (k = 0; k < 3; k++)
+        memcpy(part_lerp_coin.p[PREV][k],
+               part_lerp_coin.p[CURR][k], coin_c * sizeof (float));
 }
 
 void part_lerp_init(void)
@@ -97,31 +113,62 @@ void part_lerp_init(void)
 
 void part_lerp_burst(int i)
 {
-    if (coin_draw[i].t >= 1.0f)
+    int k;
+
+    for (k = 0; k < 3; k++)
     {
-        v_cpy(part_lerp_coin[i].p[PREV], coin_draw[i].p);
-        v_cpy(part_lerp_coin[i].p[CURR], coin_draw[i].p);
+        part_lerp_coin.p[PREV][k][i] = coin_draw[i].p[k];
+        part_lerp_coin.p[CURR][k][i] = coin_draw[i].p[k];
     }
 }
 
 void part_lerp_apply(float a)
 {
-    int i;
+    float (*p)[PART_MAX_COIN] = part_lerp_coin.p[PREV];
+    float (*q)[PART_MAX_COIN] = part_lerp_coin.p[CURR];
 
-    for (i = 0; i < PART_MAX_COIN; i++)
-        if (coin_draw[i].t > 0.0f)
-            v_lerp(coin_draw[i].p,
-                   part_lerp_coin[i].p[PREV],
-                   part_lerp_coin[i].p[CURR], a);
+    int i = 0, k;
 
-    /* Upload the current state of the particles. It would be best to limit  */
-    /* this upload to only active particles, but it's more important to do   */
-    /* it all in a single call.                                              */
+    /* Interpolate four particles per axis at a time, then interleave. */
+
+#if PART_SSE2 || PART_NEON
+    for (; i + 4 <= coin_c; i += 4)
+        for (k = 0; k < 3; k++)
+        {
+            float r[4];
+#if PART_SSE2
+            const __m128 f0 = _mm_loadu_ps(p[k] + i);
+            const __m128 f1 = _mm_loadu_ps(q[k] + i);
+
+            _mm_storeu_ps(r, _mm_add_ps(f0, _mm_mul_ps(_mm_sub_ps(f1, f0),
+                                                       _mm_set1_ps(a))));
+#else
+            const float32x4_t f0 = vld1q_f32(p[k] + i);
+            const float32x4_t f1 = vld1q_f32(q[k] + i);
+
+            vst1q_f32(r, vmlaq_n_f32(f0, vsubq_f32(f1, f0), a));
+#endif
+            coin_draw[i + 0].p[k] = r[0];
+            coin_draw[i + 1].p[k] = r[1];
+            coin_draw[i + 2].p[k] = r[2];
+            coin_draw[i + 3].p[k] = r[3];
+        }
+#endif
+
+    for (; i < coin_c; i++)
+        for (k = 0; k < 3; k++)
+            coin_draw[i].p[k] = flerp(p[k][i], q[k][i], a);
+
+    /* Upload the current state of the live particles in a single call. */
 
 #ifdef PARTICLEVBO
-    glBindBuffer_   (GL_ARRAY_BUFFER, coin_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER, 0, sizeof (coin_draw), coin_draw);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
+    if (coin_c)
+    {
+        glBindBuffer_   (GL_ARRAY_BUFFER, coin_vbo);
+        glBufferSubData_(GL_ARRAY_BUFFER, 0,
+                         coin_c * sizeof (struct part_draw), coin_draw);
+        glBindBuffer_   (GL_ARRAY_BUFFER, 0);
+    }
 #endif
 }
 
@@ -129,10 +176,7 @@ void part_lerp_apply(float a)
 
 void part_reset(void)
 {
-    int i;
-
-    for (i = 0; i < PART_MAX_COIN; i++)
-        coin_draw[i].t = 0.0f;
+    coin_c = 0;
 
     part_lerp_init();
 }
@@ -141,8 +185,8 @@ void part_init(void)
 {
     coin_mtrl = mtrl_cache(&coin_base_mtrl);
 
-    memset(coin_vary, 0, PART_MAX_COIN * sizeof (struct part_vary));
-    memset(coin_draw, 0, PART_MAX_COIN * sizeof (struct part_draw));
+    memset(&coin_vary, 0, sizeof (struct part_vary));
+    memset( coin_draw, 0, PART_MAX_COIN * sizeof (struct part_draw));
 
 #ifdef PARTICLEVBO
     glGenBuffers_(1,              &coin_vbo);
@@ -167,59 +211,124 @@ void part_free(void)
 
 void part_burst(const float *p, const float *c)
 {
-    int i, n = 0;
+    int n;
 
-    for (i = 0; n < 10 && i < PART_MAX_COIN; i++)
-        if (coin_draw[i].t <= 0.f)
-        {
-            float a = rnd(-1.0f * PI, +1.0f * PI);
-            float b = rnd(+0.3f * PI, +0.5f * PI);
+    for (n = 0; n < 10 && coin_c < PART_MAX_COIN; n++)
+    {
+        const int i = coin_c++;
 
-            coin_draw[i].c[0] = c[0];
-            coin_draw[i].c[1] = c[1];
-            coin_draw[i].c[2] = c[2];
+        float a = rnd(-1.0f * PI, +1.0f * PI);
+        float b = rnd(+0.3f * PI, +0.5f * PI);
 
-            coin_draw[i].p[0] = p[0];
-            coin_draw[i].p[1] = p[1];
-            coin_draw[i].p[2] = p[2];
+        coin_draw[i].c[0] = c[0];
+        coin_draw[i].c[1] = c[1];
+        coin_draw[i].c[2] = c[2];
 
-            coin_vary[i].v[0] = 4.f * fcosf(a) * fcosf(b);
-            coin_vary[i].v[1] = 4.f *            fsinf(b);
-            coin_vary[i].v[2] = 4.f * fsinf(a) * fcosf(b);
+        coin_draw[i].p[0] = p[0];
+        coin_draw[i].p[1] = p[1];
+        coin_draw[i].p[2] = p[2];
 
-            coin_draw[i].t = 1.f;
+        coin_vary.v[0][i] = 4.f * fcosf(a) * fcosf(b);
+        coin_vary.v[1][i] = 4.f *            fsinf(b);
+        coin_vary.v[2][i] = 4.f * fsinf(a) * fcosf(b);
 
-            part_lerp_burst(i);
+        coin_draw[i].t = 1.f;
 
-            n++;
-        }
+        part_lerp_burst(i);
+    }
 }
 
 /*---------------------------------------------------------------------------*/
 
-static void part_fall(struct part_lerp *lerp,
+static void part_kill(struct part_lerp *lerp,
                       struct part_vary *vary,
-                      struct part_draw *draw,
-                      int n, const float *g, float dt)
+                      struct part_draw *draw, int i, int j)
+{
+    int k;
+
+    /* Move particle j into the slot of dead particle i. */
+
+    draw[i] = draw[j];
+
+    for (k = 0; k < 3; k++)
+    {
+        vary->v      [k][i] = vary->v      [k][j];
+        lerp->p[CURR][k][i] = lerp->p[CURR][k][j];
+        lerp->p[PREV][k][i] = lerp->p[PREV][k][j];
+    }
+}
+
+static int part_fall(struct part_lerp *lerp,
+                     struct part_vary *vary,
+                     struct part_draw *draw,
+                     int n, const float *g, float dt)
 {
-    int i;
+    int i, k;
+
+    /* Age the live particles, and remove the dead ones. */
 
     for (i = 0; i < n; i++)
-        if (draw[i].t > 0.f)
+        draw[i].t -= dt;
+
+    for (i = 0; i < n; )
+        if (draw[i].t <= 0.0f)
+            part_kill(lerp, vary, draw, i, --n);
+        else
+            i++;
+
+    /* Integrate velocity and position of the survivors, axis by axis. */
+
+    for (k = 0; k < 3; k++)
+    {
+        float *v = vary->v[k];
+        float *p = lerp->p[CURR][k];
+
+        const float a = g[k] * dt;
+
+        i = 0;
+
+#if PART_SSE2
         {
-            draw[i].t -= dt;
+            const __m128 va = _mm_set1_ps(a);
+            const __m128 vt = _mm_set1_ps(dt);
 
-            v_mad(vary[i].v, vary[i].v, g, dt);
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 vv = _mm_add_ps(_mm_loadu_ps(v + i), va);
 
-            v_mad(lerp[i].p[CURR], lerp[i].p[CURR], vary[i].v, dt);
+                _mm_storeu_ps(v + i, vv);
+                _mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i),
+                                                _mm_mul_ps(vv, vt)));
+            }
         }
-        else draw[i].t = 0.0f;
+#elif PART_NEON
+        {
+            const float32x4_t va = vdupq_n_f32(a);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t vv = vaddq_f32(vld1q_f32(v + i), va);
+
+                vst1q_f32(v + i, vv);
+                vst1q_f32(p + i, vmlaq_n_f32(vld1q_f32(p + i), vv, dt));
+            }
+        }
+#endif
+
+        for (; i < n; i++)
+        {
+            v[i] += a;
+            p[i] += v[i] * dt;
+        }
+    }
+
+    return n;
 }
 
 void part_step(const float *g, float dt)
 {
     part_lerp_copy();
-    part_fall(part_lerp_coin, coin_vary, coin_draw, PART_MAX_COIN, g, dt);
+    coin_c = part_fall(&part_lerp_coin, &coin_vary, coin_draw, coin_c, g, dt);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -228,9 +337,12 @@ void part_draw_coin(struct s_rend *rend)
 {
     GLfloat height = (hmd_stat() ? 0.3f : 1.0f) * video.device_h;
 
-    r_apply_mtrl(rend, coin_mtrl);
+    /* Draw the live range only. */
 
-    /* Draw the entire buffer.  Dead particles have zero opacity anyway. */
+    if (coin_c == 0)
+        return;
+
+    r_apply_mtrl(rend, coin_mtrl);
 
 #ifdef PARTICLEVBO
     glBindBuffer_(GL_ARRAY_BUFFER, coin_vbo);
@@ -260,7 +372,9 @@ void part_draw_coin(struct s_rend *rend)
             glPointParameterfv_(GL_POINT_DISTANCE_ATTENUATION, c);
             glPointSize(height / 6);
 
-            glDrawArrays(GL_POINTS, 0, PART_MAX_COIN);
+            glDrawArrays(GL_POINTS, 0, coin_c);
+
+            rend->count.draw_calls++;
         }
         glDisable(GL_POINT_SPRITE);
     }
@@ -7,7 +7,7 @@
 
 #define IMG_PART_STAR     "png/part"
 
-#define PART_MAX_COIN  64
+#define PART_MAX_COIN  1024
 #define PART_MAX_GOAL  64
 #define PART_MAX_JUMP  64
 
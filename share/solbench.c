@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Time the load-time assembly of render meshes for each of the given
+ * SOL files, as done for files compiled without precompiled meshes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "solid_base.h"
+#include "fs.h"
+
+/*---------------------------------------------------------------------------*/
+
+static void free_mesh(struct s_base *fp)
+{
+    free(fp->kv);
+    free(fp->yv);
+    free(fp->qv);
+
+    fp->kv = NULL;
+    fp->yv = NULL;
+    fp->qv = NULL;
+
+    fp->kc = 0;
+    fp->yc = 0;
+    fp->qc = 0;
+}
+
+static double bench_file(struct s_base *fp, int n)
+{
+    struct timeval time0;
+    struct timeval time1;
+    int i;
+
+    gettimeofday(&time0, 0);
+
+    for (i = 0; i < n; i++)
+    {
+        free_mesh(fp);
+        sol_mesh_base(fp);
+    }
+
+    gettimeofday(&time1, 0);
+
+    return ((time1.tv_sec  - time0.tv_sec) * 1000.0 +
+            (time1.tv_usec - time0.tv_usec) / 1000.0) / n;
+}
+
+int main(int argc, char *argv[])
+{
+    int argi, n = 10;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <data> [-n count] <sol>...\n", argv[0]);
+        return 1;
+    }
+
+    if (!fs_init(argv[0]) || !fs_add_path_with_archives(argv[1]))
+    {
+        fprintf(stderr, "Failure to establish data directory\n");
+        return 1;
+    }
+
+    printf("%-40s %6s %6s %6s %6s %10s\n",
+           "file", "mtrl", "body", "geom", "mesh", "ms");
+
+    for (argi = 2; argi < argc; argi++)
+    {
+        struct s_base base;
+        double t;
+
+        if (strcmp(argv[argi], "-n") == 0)
+        {
+            if (++argi < argc)
+                n = atoi(argv[argi]) > 0 ? atoi(argv[argi]) : n;
+            continue;
+        }
+
+        if (!sol_load_base(&base, argv[argi]))
+        {
+            fprintf(stderr, "Failure to load %s\n", argv[argi]);
+            continue;
+        }
+
+        t = bench_file(&base, n);
+
+        printf("%-40s %6d %6d %6d %6d %10.3f\n", argv[argi],
+               base.mc, base.bc, base.gc, base.kc, t);
+
+        sol_free_base(&base);
+    }
+
+    fs_quit();
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
@@ -26,11 +26,12 @@
 enum
 {
     SOL_VERSION_1_5 = 6,
-    SOL_VERSION_DEV
+    SOL_VERSION_DEV,
+    SOL_VERSION_MESH
 };
 
 #define SOL_VERSION_MIN  SOL_VERSION_1_5
-#define SOL_VERSION_CURR SOL_VERSION_DEV
+#define SOL_VERSION_CURR SOL_VERSION_MESH
 
 #define SOL_MAGIC (0xAF | 'S' << 8 | 'O' << 16 | 'L' << 24)
 
@@ -338,6 +339,78 @@ static void sol_load_dict(fs_file fin, struct b_dict *dp)
     dp->aj = get_index(fin);
 }
 
+static void sol_load_mesh(fs_file fin, struct b_mesh *kp)
+{
+    kp->bi = get_index(fin);
+    kp->mi = get_index(fin);
+    kp->y0 = get_index(fin);
+    kp->yc = get_index(fin);
+    kp->q0 = get_index(fin);
+    kp->qc = get_index(fin);
+}
+
+static int in_range(int i, int c)
+{
+    return (i >= 0 && i < c);
+}
+
+static int in_span(int i0, int n, int c)
+{
+    return (i0 >= 0 && n >= 0 && i0 <= c - n);
+}
+
+/*
+ * Check that the mesh section was allocated and that every mesh and
+ * mesh triangle refers to data that exists.
+ */
+static int sol_test_mesh(const struct s_base *fp)
+{
+    int ki, qi;
+
+    if (fp->kc < 0 || fp->yc < 0 || fp->qc < 0)
+        return 0;
+
+    if ((fp->kc && !fp->kv) || (fp->yc && !fp->yv) || (fp->qc && !fp->qv))
+        return 0;
+
+    for (ki = 0; ki < fp->kc; ki++)
+    {
+        const struct b_mesh *kp = fp->kv + ki;
+
+        if (!in_range(kp->bi, fp->bc) ||
+            !in_range(kp->mi, fp->mc) ||
+            !in_span (kp->y0, kp->yc, fp->yc) ||
+            !in_span (kp->q0, kp->qc, fp->qc) || kp->yc > MESH_VERT_MAX)
+            return 0;
+
+        for (qi = kp->q0; qi < kp->q0 + kp->qc; qi++)
+        {
+            const struct b_elem *qp = fp->qv + qi;
+
+            if (!in_range(qp->yi, kp->yc) ||
+                !in_range(qp->yj, kp->yc) ||
+                !in_range(qp->yk, kp->yc))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static void sol_free_mesh(struct s_base *fp)
+{
+    free(fp->kv);
+    free(fp->yv);
+    free(fp->qv);
+
+    fp->kv = NULL;
+    fp->yv = NULL;
+    fp->qv = NULL;
+
+    fp->kc = 0;
+    fp->yc = 0;
+    fp->qc = 0;
+}
+
 static void sol_load_indx(fs_file fin, struct s_base *fp)
 {
     fp->ac = get_index(fin);
@@ -364,6 +437,13 @@ static void sol_load_indx(fs_file fin, struct s_base *fp)
     fp->uc = get_index(fin);
     fp->wc = get_index(fin);
     fp->ic = get_index(fin);
+
+    if (sol_version >= SOL_VERSION_MESH)
+    {
+        fp->kc = get_index(fin);
+        fp->yc = get_index(fin);
+        fp->qc = get_index(fin);
+    }
 }
 
 static int sol_load_file(fs_file fin, struct s_base *fp)
@@ -417,6 +497,12 @@ static int sol_load_file(fs_file fin, struct s_base *fp)
         fp->dv = (struct b_dict *) calloc(fp->dc, sizeof (*fp->dv));
     if (fp->ic)
         fp->iv = (int *)           calloc(fp->ic, sizeof (*fp->iv));
+    if (fp->kc)
+        fp->kv = (struct b_mesh *) calloc(fp->kc, sizeof (*fp->kv));
+    if (fp->yc)
+        fp->yv = (struct b_attr *) calloc(fp->yc, sizeof (*fp->yv));
+    if (fp->qc)
+        fp->qv = (struct b_elem *) calloc(fp->qc, sizeof (*fp->qv));
 
     if (fp->ac)
         fs_read(fp->av, 1, fp->ac, fin);
@@ -442,6 +528,21 @@ static int sol_load_file(fs_file fin, struct s_base *fp)
     for (i = 0; i < fp->wc; i++) sol_load_view(fin, fp->wv + i);
     for (i = 0; i < fp->ic; i++) fp->iv[i] = get_index(fin);
 
+    /* Mesh vertices and triangles are read as single blocks. */
+
+    if (fp->kv) for (i = 0; i < fp->kc; i++) sol_load_mesh(fin, fp->kv + i);
+
+    if (fp->yv) get_array      (fin, fp->yv->p, fp->yc * 8);
+    if (fp->qv) get_index_array(fin, &fp->qv->yi, fp->qc * 3);
+
+    /* Rebuild the meshes of a truncated or corrupt mesh section. */
+
+    if (!sol_test_mesh(fp))
+    {
+        sol_free_mesh(fp);
+        sol_mesh_base(fp);
+    }
+
     /* Magically "fix" all of our code. */
 
     if (!fp->uc)
@@ -532,6 +633,9 @@ void sol_free_base(struct s_base *fp)
     if (fp->wv) free(fp->wv);
     if (fp->dv) free(fp->dv);
     if (fp->iv) free(fp->iv);
+    if (fp->kv) free(fp->kv);
+    if (fp->yv) free(fp->yv);
+    if (fp->qv) free(fp->qv);
 
     memset(fp, 0, sizeof (*fp));
 }
@@ -703,6 +807,16 @@ static void sol_stor_dict(fs_file fout, struct b_dict *dp)
     put_index(fout, dp->aj);
 }
 
+static void sol_stor_mesh(fs_file fout, struct b_mesh *kp)
+{
+    put_index(fout, kp->bi);
+    put_index(fout, kp->mi);
+    put_index(fout, kp->y0);
+    put_index(fout, kp->yc);
+    put_index(fout, kp->q0);
+    put_index(fout, kp->qc);
+}
+
 static void sol_stor_file(fs_file fout, struct s_base *fp)
 {
     int i;
@@ -733,6 +847,9 @@ static void sol_stor_file(fs_file fout, struct s_base *fp)
     put_index(fout, fp->uc);
     put_index(fout, fp->wc);
     put_index(fout, fp->ic);
+    put_index(fout, fp->kc);
+    put_index(fout, fp->yc);
+    put_index(fout, fp->qc);
 
     fs_write(fp->av, 1, fp->ac, fout);
 
@@ -756,6 +873,10 @@ static void sol_stor_file(fs_file fout, struct s_base *fp)
     for (i = 0; i < fp->uc; i++) sol_stor_ball(fout, fp->uv + i);
     for (i = 0; i < fp->wc; i++) sol_stor_view(fout, fp->wv + i);
     for (i = 0; i < fp->ic; i++) put_index(fout, fp->iv[i]);
+    for (i = 0; i < fp->kc; i++) sol_stor_mesh(fout, fp->kv + i);
+
+    if (fp->yc) put_array      (fout, fp->yv->p, fp->yc * 8);
+    if (fp->qc) put_index_array(fout, &fp->qv->yi, fp->qc * 3);
 }
 
 int sol_stor_base(struct s_base *fp, const char *filename)
@@ -774,6 +895,274 @@ int sol_stor_base(struct s_base *fp, const char *filename)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Assemble  the render meshes  of a file: one for  each body and material,
+ * with a vertex for each distinct offs, in geom order.  The geoms of each
+ * body are bucketed by material with a counting sort, and the offs remap
+ * is reset sparsely, so the whole file is assembled in a single pass.  A
+ * mesh that outgrows MESH_VERT_MAX vertices continues in another.
+ */
+
+static int sol_mesh_vert(struct s_base *fp, struct b_mesh *kp,
+                         int *ym, int *om, int oi)
+{
+    if (ym[oi] == -1)
+    {
+        const struct b_offs *op = fp->ov + oi;
+
+        struct b_attr *yp = fp->yv + kp->y0 + kp->yc;
+
+        v_cpy(yp->p, fp->vv[op->vi].p);
+        v_cpy(yp->n, fp->sv[op->si].n);
+
+        yp->t[0] = fp->tv[op->ti].u[0];
+        yp->t[1] = fp->tv[op->ti].u[1];
+
+        om[kp->yc] = oi;
+        ym[oi]     = kp->yc++;
+    }
+    return ym[oi];
+}
+
+static struct b_mesh *sol_mesh_open(struct s_base *fp, int bi, int mi)
+{
+    struct b_mesh *kp = fp->kv + fp->kc;
+
+    kp->bi = bi;
+    kp->mi = mi;
+    kp->y0 = fp->yc;
+    kp->q0 = fp->qc;
+
+    return kp;
+}
+
+static void sol_mesh_done(struct s_base *fp, struct b_mesh *kp,
+                          int *ym, const int *om)
+{
+    int i;
+
+    /* Reset the remapping of the offs this mesh used. */
+
+    for (i = 0; i < kp->yc; i++)
+        ym[om[i]] = -1;
+
+    fp->kc += 1;
+    fp->yc += kp->yc;
+    fp->qc += kp->qc;
+}
+
+static int sol_mesh_body(const struct s_base *fp, const struct b_body *bp,
+                         int *gl)
+{
+    int li, gi, n = 0;
+
+    /* List the geoms of all lumps, then those of the body itself. */
+
+    for (li = 0; li < bp->lc; li++)
+    {
+        const struct b_lump *lp = fp->lv + bp->l0 + li;
+
+        for (gi = 0; gi < lp->gc; gi++)
+            gl[n++] = fp->iv[lp->g0 + gi];
+    }
+
+    for (gi = 0; gi < bp->gc; gi++)
+        gl[n++] = fp->iv[bp->g0 + gi];
+
+    return n;
+}
+
+/*
+ * Check that all geometry a mesh could be assembled from exists.
+ */
+static int sol_mesh_test(const struct s_base *fp)
+{
+    int i, j;
+
+    if ((fp->bc && !fp->bv) || (fp->lc && !fp->lv) || (fp->ic && !fp->iv) ||
+        (fp->gc && !fp->gv) || (fp->oc && !fp->ov) || (fp->vc && !fp->vv) ||
+        (fp->sc && !fp->sv) || (fp->tc && !fp->tv))
+        return 0;
+
+    for (i = 0; i < fp->bc; i++)
+    {
+        const struct b_body *bp = fp->bv + i;
+
+        if (!in_span(bp->l0, bp->lc, fp->lc) ||
+            !in_span(bp->g0, bp->gc, fp->ic))
+            return 0;
+
+        for (j = bp->g0; j < bp->g0 + bp->gc; j++)
+            if (!in_range(fp->iv[j], fp->gc))
+                return 0;
+    }
+
+    for (i = 0; i < fp->lc; i++)
+    {
+        const struct b_lump *lp = fp->lv + i;
+
+        if (!in_span(lp->g0, lp->gc, fp->ic))
+            return 0;
+
+        for (j = lp->g0; j < lp->g0 + lp->gc; j++)
+            if (!in_range(fp->iv[j], fp->gc))
+                return 0;
+    }
+
+    for (i = 0; i < fp->gc; i++)
+    {
+        const struct b_geom *gp = fp->gv + i;
+
+        if (!in_range(gp->mi, fp->mc) ||
+            !in_range(gp->oi, fp->oc) ||
+            !in_range(gp->oj, fp->oc) ||
+            !in_range(gp->ok, fp->oc))
+            return 0;
+    }
+
+    for (i = 0; i < fp->oc; i++)
+    {
+        const struct b_offs *op = fp->ov + i;
+
+        if (!in_range(op->vi, fp->vc) ||
+            !in_range(op->si, fp->sc) ||
+            !in_range(op->ti, fp->tc))
+            return 0;
+    }
+
+    return 1;
+}
+
+int sol_mesh_base(struct s_base *fp)
+{
+    int *gl = NULL;
+    int *gs = NULL;
+    int *mn = NULL;
+    int *ym = NULL;
+    int *om = NULL;
+
+    int bi, li, mi, i, n, gc = 0, gm = 0, kc = 0;
+
+    /* Refuse geometry that refers outside of the file. */
+
+    fp->kc = 0;
+    fp->yc = 0;
+    fp->qc = 0;
+
+    if (!sol_mesh_test(fp))
+        return 0;
+
+    /* Bound the mesh data by the geom counts. */
+
+    for (bi = 0; bi < fp->bc; bi++)
+    {
+        n = fp->bv[bi].gc;
+
+        for (li = 0; li < fp->bv[bi].lc; li++)
+            n += fp->lv[fp->bv[bi].l0 + li].gc;
+
+        gc += n;
+        gm  = MAX(gm, n);
+        kc += MIN(n, fp->mc) + 3 * n / (MESH_VERT_MAX - 2);
+    }
+
+    if (gc == 0)
+        return 1;
+
+    if ((fp->kv = (struct b_mesh *) calloc(kc,     sizeof (*fp->kv))) &&
+        (fp->qv = (struct b_elem *) calloc(gc,     sizeof (*fp->qv))) &&
+        (fp->yv = (struct b_attr *) calloc(gc * 3, sizeof (*fp->yv))) &&
+        (gl = (int *) malloc(sizeof (int) * gm)) &&
+        (gs = (int *) malloc(sizeof (int) * gm)) &&
+        (om = (int *) malloc(sizeof (int) * gm * 3)) &&
+        (mn = (int *) malloc(sizeof (int) * (fp->mc + 1))) &&
+        (ym = (int *) malloc(sizeof (int) * fp->oc)))
+    {
+        for (i = 0; i < fp->oc; i++)
+            ym[i] = -1;
+
+        for (bi = 0; bi < fp->bc; bi++)
+        {
+            int i0 = 0;
+
+            n = sol_mesh_body(fp, fp->bv + bi, gl);
+
+            /* Counting sort the geoms by material, preserving order. */
+
+            memset(mn, 0, (fp->mc + 1) * sizeof (int));
+
+            for (i = 0; i < n; i++)
+                mn[fp->gv[gl[i]].mi + 1]++;
+            for (mi = 0; mi < fp->mc; mi++)
+                mn[mi + 1] += mn[mi];
+            for (i = 0; i < n; i++)
+                gs[mn[fp->gv[gl[i]].mi]++] = gl[i];
+
+            /* Each material's bucket now ends where the next begins. */
+
+            for (mi = 0; mi < fp->mc; i0 = mn[mi++])
+            {
+                struct b_mesh *kp = NULL;
+
+                for (i = i0; i < mn[mi]; i++)
+                {
+                    const struct b_geom *gp = fp->gv + gs[i];
+                    struct b_elem       *qp;
+
+                    /* Split meshes to keep them within 16-bit indices. */
+
+                    if (kp == NULL || kp->yc + 3 > MESH_VERT_MAX)
+                    {
+                        if (kp)
+                            sol_mesh_done(fp, kp, ym, om);
+
+                        kp = sol_mesh_open(fp, bi, mi);
+                    }
+
+                    qp = fp->qv + kp->q0 + kp->qc++;
+
+                    qp->yi = sol_mesh_vert(fp, kp, ym, om, gp->oi);
+                    qp->yj = sol_mesh_vert(fp, kp, ym, om, gp->oj);
+                    qp->yk = sol_mesh_vert(fp, kp, ym, om, gp->ok);
+                }
+
+                if (kp)
+                    sol_mesh_done(fp, kp, ym, om);
+            }
+        }
+
+        /* Give back the vertex space that sharing saved. */
+
+        if (fp->yc < gc * 3)
+        {
+            void *p = realloc(fp->yv, MAX(fp->yc, 1) * sizeof (*fp->yv));
+
+            if (p)
+                fp->yv = (struct b_attr *) p;
+        }
+    }
+    else
+    {
+        free(fp->kv);
+        free(fp->qv);
+        free(fp->yv);
+
+        fp->kv = NULL;
+        fp->qv = NULL;
+        fp->yv = NULL;
+    }
+
+    free(ym);
+    free(mn);
+    free(om);
+    free(gs);
+    free(gl);
+
+    return fp->kv ? 1 : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
 const struct path tex_paths[4] = {
     { "textures/", ".png" },
     { "textures/", ".jpg" },
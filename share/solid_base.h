@@ -51,6 +51,9 @@
  *     u  User          (struct b_ball)
  *     w  Viewpoint     (struct b_view)
  *     d  Dictionary    (struct b_dict)
+ *     k  Mesh          (struct b_mesh)
+ *     y  Mesh vertex   (struct b_attr)
+ *     q  Mesh triangle (struct b_elem)
  *     i  Index         (int)
  *     a  Text          (char)
  *
@@ -72,7 +75,7 @@
  * Those members that do not conform to this convention are explicitly
  * documented with a comment.
  *
- * These prefixes are still available: c k q y.
+ * These prefixes are still available: c.
  */
 
 /*
@@ -283,6 +286,38 @@ struct b_dict
     int aj;
 };
 
+/*
+ * Precompiled render meshes.  A mesh holds the triangles of one body
+ * using one material, ready for upload as vertex and element buffers.
+ * Element indices are relative to the mesh's first vertex.
+ */
+
+#define MESH_VERT_MAX 65536
+
+struct b_mesh
+{
+    int bi;
+    int mi;
+    int y0;
+    int yc;
+    int q0;
+    int qc;
+};
+
+struct b_attr
+{
+    float p[3];                                /* position                   */
+    float n[3];                                /* normal                     */
+    float t[2];                                /* texture coordinate         */
+};
+
+struct b_elem
+{
+    int yi;
+    int yj;
+    int yk;
+};
+
 struct s_base
 {
     int ac;
@@ -306,6 +341,9 @@ struct s_base
     int wc;
     int dc;
     int ic;
+    int kc;
+    int yc;
+    int qc;
 
     char          *av;
     struct b_mtrl *mv;
@@ -328,6 +366,9 @@ struct s_base
     struct b_view *wv;
     struct b_dict *dv;
     int           *iv;
+    struct b_mesh *kv;
+    struct b_attr *yv;
+    struct b_elem *qv;
 
     /*
      * A mapping from internal to cached material indices.
@@ -341,6 +382,7 @@ int  sol_load_base(struct s_base *, const char *);
 int  sol_load_meta(struct s_base *, const char *);
 void sol_free_base(struct s_base *);
 int  sol_stor_base(struct s_base *, const char *);
+int  sol_mesh_base(struct s_base *);
 
 /*---------------------------------------------------------------------------*/
 
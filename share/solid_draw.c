@@ -20,6 +20,14 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DRAW_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DRAW_NEON 1
+#endif
+
 #include "glext.h"
 #include "video.h"
 #include "vec3.h"
@@ -35,6 +43,10 @@
 
 /*---------------------------------------------------------------------------*/
 
+struct r_count r_total;
+
+/*---------------------------------------------------------------------------*/
+
 /*
  * Included and excluded material flags for each rendering pass.
  */
@@ -130,6 +142,286 @@ static void sol_transform(const struct s_vary *vary,
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * View-frustum culling. Bounding boxes are kept in body space and are
+ * tested against the frustum planes of each body's own clip matrix.
+ */
+
+static void sol_cull_view(float *V)
+{
+    float P[16];
+    float M[16];
+
+    /* Compose the current projection and model-view matrices. */
+
+    glGetFloatv(GL_PROJECTION_MATRIX, P);
+    glGetFloatv(GL_MODELVIEW_MATRIX,  M);
+
+    m_mult(V, P, M);
+}
+
+static void sol_body_matrix(float *M, const struct s_vary *vary,
+                            const struct v_body *bp)
+{
+    float a;
+    float e[4];
+    float p[3];
+    float v[3];
+
+    /* Compose the body transform as sol_transform applies it. */
+
+    sol_body_p(p, vary, bp, 0.0f);
+    sol_body_e(e, vary, bp, 0.0f);
+
+    q_as_axisangle(e, v, &a);
+
+    m_xlt(M, p);
+
+    if (!((v[0] == 0 && v[1] == 0 && v[2] == 0) || a == 0))
+    {
+        float R[16];
+        float T[16];
+
+        m_rot(R, v, a);
+        m_cpy(T, M);
+        m_mult(M, T, R);
+    }
+}
+
+static void sol_cull_plane(float *P, const float *B, int i, float k, float s)
+{
+    /* Bound clip coordinate i by k w, on the side given by the sign s. */
+
+    P[0] = s * (B[i +  0] - k * B[3]);
+    P[1] = s * (B[i +  4] - k * B[7]);
+    P[2] = s * (B[i +  8] - k * B[11]);
+    P[3] = s * (B[i + 12] - k * B[15]);
+}
+
+static void sol_clip_body(float *B, const float *V,
+                          const struct s_vary *vary,
+                          const struct v_body *bp)
+{
+    float M[16];
+
+    sol_body_matrix(M, vary, bp);
+
+    m_mult(B, V, M);
+}
+
+static void sol_cull_body(float P[6][4], const float *B, const float *r)
+{
+    /* Extract the clip planes of rectangle r and the depth range. */
+
+    sol_cull_plane(P[0], B, 0, r[0], +1.0f);
+    sol_cull_plane(P[1], B, 0, r[2], -1.0f);
+    sol_cull_plane(P[2], B, 1, r[1], +1.0f);
+    sol_cull_plane(P[3], B, 1, r[3], -1.0f);
+    sol_cull_plane(P[4], B, 2, -1.0f, +1.0f);
+    sol_cull_plane(P[5], B, 2, +1.0f, -1.0f);
+}
+
+static int sol_cull_test(const float *P, const float *b)
+{
+    int i;
+
+    /* Test the box corner furthest along each plane normal. */
+
+    for (i = 0; i < 6; i++, P += 4)
+        if (P[0] * (P[0] > 0.0f ? b[3] : b[0]) +
+            P[1] * (P[1] > 0.0f ? b[4] : b[1]) +
+            P[2] * (P[2] > 0.0f ? b[5] : b[2]) + P[3] < 0.0f)
+            return 1;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Billboard scratch space.  The size and rotation functions of all of a
+ * file's billboards are evaluated together, one row of floats per
+ * coefficient, argument and result.  Vertices and materials are kept
+ * for as many instances as have been drawn at once.
+ */
+
+enum
+{
+    BILL_W = 0,
+    BILL_H,
+    BILL_RX,
+    BILL_RY,
+    BILL_RZ,
+
+    BILL_MAX
+};
+
+struct bill_vert
+{
+    GLfloat t[2];
+    GLfloat p[3];
+};
+
+struct d_bill
+{
+    int rc;
+
+    float *cv;                          /* Coefficients, 3 rows per function */
+    float *tv;                          /* Repeat intervals                  */
+    float *av;                          /* Arguments, 2 rows                 */
+    float *ev;                          /* Results, 1 row per function       */
+
+    struct bill_vert *vv;               /* Vertices, 6 per billboard         */
+    int              *mv;               /* Materials                         */
+    int               pm;               /* Instances the above hold          */
+};
+
+static void sol_load_bill_eval(struct s_draw *draw)
+{
+    const struct s_base *base = draw->base;
+    const int rc = base->rc;
+
+    struct d_bill *bs;
+    int ri, f;
+
+    if (rc == 0 || !(bs = (struct d_bill *) calloc(1, sizeof (*bs))))
+        return;
+
+    bs->rc = rc;
+    bs->pm = 1;
+
+    bs->cv = (float *) malloc(rc * (BILL_MAX * 3 + 1 + 2 + BILL_MAX) *
+                              sizeof (float));
+    bs->vv = (struct bill_vert *) malloc(rc * 6 * sizeof (*bs->vv));
+    bs->mv = (int              *) malloc(rc *     sizeof (*bs->mv));
+
+    if (!bs->cv || !bs->vv || !bs->mv)
+    {
+        free(bs->mv);
+        free(bs->vv);
+        free(bs->cv);
+        free(bs);
+        return;
+    }
+
+    bs->tv = bs->cv + rc * BILL_MAX * 3;
+    bs->av = bs->tv + rc;
+    bs->ev = bs->av + rc * 2;
+
+    /* Transpose the coefficients into rows. */
+
+    for (ri = 0; ri < rc; ri++)
+    {
+        const struct b_bill *rp = base->rv + ri;
+
+        const float *c[BILL_MAX];
+
+        c[BILL_W]  = rp->w;
+        c[BILL_H]  = rp->h;
+        c[BILL_RX] = rp->rx;
+        c[BILL_RY] = rp->ry;
+        c[BILL_RZ] = rp->rz;
+
+        for (f = 0; f < BILL_MAX; f++)
+        {
+            bs->cv[(f * 3 + 0) * rc + ri] = c[f][0];
+            bs->cv[(f * 3 + 1) * rc + ri] = c[f][1];
+            bs->cv[(f * 3 + 2) * rc + ri] = c[f][2];
+        }
+        bs->tv[ri] = rp->t;
+    }
+
+    draw->bs = bs;
+}
+
+static void sol_free_bill_eval(struct s_draw *draw)
+{
+    if (draw->bs)
+    {
+        free(draw->bs->mv);
+        free(draw->bs->vv);
+        free(draw->bs->cv);
+        free(draw->bs);
+
+        draw->bs = NULL;
+    }
+}
+
+/*
+ * Make room in the scratch space for PC instances.
+ */
+static int sol_grow_bill_eval(struct d_bill *bs, int pc)
+{
+    if (pc > bs->pm)
+    {
+        struct bill_vert *vv;
+        int              *mv;
+
+        if (!(vv = realloc(bs->vv, bs->rc * 6 * pc * sizeof (*vv))))
+            return 0;
+
+        bs->vv = vv;
+
+        if (!(mv = realloc(bs->mv, bs->rc * pc * sizeof (*mv))))
+            return 0;
+
+        bs->mv = mv;
+        bs->pm = pc;
+    }
+    return 1;
+}
+
+/*
+ * Evaluate e = c0 + c1 * a + c2 * b over N billboards.
+ */
+static void sol_bill_poly(float *e, const float *c, const float *a,
+                          const float *b, int n)
+{
+    const float *c0 = c;
+    const float *c1 = c + n;
+    const float *c2 = c + n * 2;
+
+    int i = 0;
+
+#if DRAW_SSE2
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(c0 + i);
+
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(c1 + i),
+                                     _mm_loadu_ps(a  + i)));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(c2 + i),
+                                     _mm_loadu_ps(b  + i)));
+
+        _mm_storeu_ps(e + i, v);
+    }
+#elif DRAW_NEON
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(e + i, vmlaq_f32(vmlaq_f32(vld1q_f32(c0 + i),
+                                             vld1q_f32(c1 + i),
+                                             vld1q_f32(a  + i)),
+                                   vld1q_f32(c2 + i),
+                                   vld1q_f32(b  + i)));
+#endif
+
+    for (; i < n; i++)
+        e[i] = c0[i] + c1[i] * a[i] + c2[i] * b[i];
+}
+
+/*
+ * Evaluate all size and rotation functions from the argument rows.
+ */
+static void sol_bill_eval(struct d_bill *bs)
+{
+    const int rc = bs->rc;
+
+    int f;
+
+    for (f = 0; f < BILL_MAX; f++)
+        sol_bill_poly(bs->ev + f * rc, bs->cv + f * 3 * rc,
+                      bs->av, bs->av + rc, rc);
+}
+
 static void sol_load_bill(struct s_draw *draw)
 {
     static const GLfloat data[] = {
@@ -150,19 +442,26 @@ static void sol_load_bill(struct s_draw *draw)
     glBindBuffer_(GL_ARRAY_BUFFER, draw->bill);
     glBufferData_(GL_ARRAY_BUFFER, sizeof (data), data, GL_STATIC_DRAW);
     glBindBuffer_(GL_ARRAY_BUFFER, 0);
+
+    sol_load_bill_eval(draw);
 }
 
 static void sol_free_bill(struct s_draw *draw)
 {
     glDeleteBuffers_(1, &draw->bill);
+
+    sol_free_bill_eval(draw);
 }
 
-static void sol_draw_bill(GLboolean edge)
+static void sol_draw_bill(struct s_rend *rend, GLboolean edge)
 {
     if (edge)
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     else
         glDrawArrays(GL_TRIANGLE_STRIP, 4, 4);
+
+    rend->count.draw_calls++;
+    rend->count.tris += 2;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -206,39 +505,6 @@ static int sol_test_mtrl(int mi, int p)
 
 /*---------------------------------------------------------------------------*/
 
-static int sol_count_geom(const struct s_base *base, int g0, int gc, int mi)
-{
-    int gi, c = 0;
-
-    /* The arguments g0 and gc specify a range of the index array. These     */
-    /* indices refer to geoms. Determine how many of these geoms use the     */
-    /* given material                                                        */
-
-    for (gi = 0; gi < gc; gi++)
-        if (base->gv[base->iv[g0 + gi]].mi == mi)
-            c++;
-
-    return c;
-}
-
-static int sol_count_body(const struct b_body *bp,
-                          const struct s_base *base, int mi)
-{
-    int li, c = 0;
-
-    /* Count all lump geoms with the given material. */
-
-    for (li = 0; li < bp->lc; li++)
-        c += sol_count_geom(base, base->lv[bp->l0 + li].g0,
-                                  base->lv[bp->l0 + li].gc, mi);
-
-    /* Count all body geoms with the given material. */
-
-    c += sol_count_geom(base, bp->g0, bp->gc, mi);
-
-    return c;
-}
-
 static int sol_count_mesh(const struct d_body *bp, int p)
 {
     int mi, c = 0;
@@ -254,133 +520,76 @@ static int sol_count_mesh(const struct d_body *bp, int p)
 
 /*---------------------------------------------------------------------------*/
 
-static void sol_mesh_vert(struct d_vert *vp,
-                          const struct s_base *base, int oi)
-{
-    /* Gather all vertex attributes for the given offs. */
-
-    const struct b_texc *tq = base->tv + base->ov[oi].ti;
-    const struct b_side *sq = base->sv + base->ov[oi].si;
-    const struct b_vert *vq = base->vv + base->ov[oi].vi;
-
-    vp->p[0] = vq->p[0];
-    vp->p[1] = vq->p[1];
-    vp->p[2] = vq->p[2];
-
-    vp->n[0] = sq->n[0];
-    vp->n[1] = sq->n[1];
-    vp->n[2] = sq->n[2];
-
-    vp->t[0] = tq->u[0];
-    vp->t[1] = tq->u[1];
-}
-
-static void sol_mesh_geom(struct d_vert *vv,   int *vn,
-                          struct d_geom *gv,   int *gn,
-                          const struct s_base *base, int *iv, int g0, int gc, int mi)
-{
-    int gi;
-
-    /* Insert all geoms with material mi into the vertex and element data. */
-
-    for (gi = 0; gi < gc; gi++)
-    {
-        const struct b_geom *gq = base->gv + base->iv[g0 + gi];
-
-        if (gq->mi == mi)
-        {
-            /* Insert a d_vert into the VBO data for each referenced b_off. */
-
-            if (iv[gq->oi] == -1)
-            {
-                iv[gq->oi] = *vn;
-                sol_mesh_vert(vv + (*vn)++, base, gq->oi);
-            }
-            if (iv[gq->oj] == -1)
-            {
-                iv[gq->oj] = *vn;
-                sol_mesh_vert(vv + (*vn)++, base, gq->oj);
-            }
-            if (iv[gq->ok] == -1)
-            {
-                iv[gq->ok] = *vn;
-                sol_mesh_vert(vv + (*vn)++, base, gq->ok);
-            }
-
-            /* Populate the EBO data using remapped b_off indices. */
-
-            gv[*gn].i = iv[gq->oi];
-            gv[*gn].j = iv[gq->oj];
-            gv[*gn].k = iv[gq->ok];
-
-            (*gn)++;
-        }
-    }
-}
-
 static void sol_load_mesh(struct d_mesh *mp,
-                          const struct b_body *bp,
-                          const struct s_draw *draw, int mi)
+                          const struct b_mesh *kp,
+                          const struct s_draw *draw)
 {
     const size_t vs = sizeof (struct d_vert);
     const size_t gs = sizeof (struct d_geom);
 
-    struct d_vert *vv = 0;
-    struct d_geom *gv = 0;
-    int           *iv = 0;
-
-    int oc = draw->base->oc;
-    int vn = 0;
-    int gn = 0;
+    const struct s_base *base = draw->base;
+    const struct b_elem *qv   = base->qv + kp->q0;
 
-    const int gc = sol_count_body(bp, draw->base, mi);
+    struct d_geom *gv;
 
-    /* Get temporary storage for vertex and element array creation. */
+    /* Get temporary storage for the element array. */
 
-    if ((vv = (struct d_vert *) calloc(oc, vs)) &&
-        (gv = (struct d_geom *) calloc(gc, gs)) &&
-        (iv = (int           *) calloc(oc, sizeof (int))))
+    if ((gv = (struct d_geom *) calloc(kp->qc, gs)))
     {
-        int li, i;
-
-        /* Initialize the index remapping. */
-
-        for (i = 0; i < oc; ++i) iv[i] = -1;
-
-        /* Include all matching lump geoms in the arrays. */
+        int qi;
 
-        for (li = 0; li < bp->lc; li++)
-            sol_mesh_geom(vv, &vn, gv, &gn, draw->base, iv,
-                          draw->base->lv[bp->l0 + li].g0,
-                          draw->base->lv[bp->l0 + li].gc, mi);
-
-        /* Include all matching body geoms in the arrays. */
-
-        sol_mesh_geom(vv, &vn, gv, &gn, draw->base, iv, bp->g0, bp->gc, mi);
+        for (qi = 0; qi < kp->qc; qi++)
+        {
+            gv[qi].i = qv[qi].yi;
+            gv[qi].j = qv[qi].yj;
+            gv[qi].k = qv[qi].yk;
+        }
 
-        /* Initialize buffer objects for all data. */
+        /* Initialize buffer objects. b_attr matches d_vert exactly. */
 
         glGenBuffers_(1, &mp->vbo);
         glBindBuffer_(GL_ARRAY_BUFFER,         mp->vbo);
-        glBufferData_(GL_ARRAY_BUFFER,         vn * vs, vv, GL_STATIC_DRAW);
+        glBufferData_(GL_ARRAY_BUFFER,         kp->yc * vs,
+                      base->yv + kp->y0, GL_STATIC_DRAW);
         glBindBuffer_(GL_ARRAY_BUFFER,         0);
 
         glGenBuffers_(1, &mp->ebo);
         glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, mp->ebo);
-        glBufferData_(GL_ELEMENT_ARRAY_BUFFER, gn * gs, gv, GL_STATIC_DRAW);
+        glBufferData_(GL_ELEMENT_ARRAY_BUFFER, kp->qc * gs, gv, GL_STATIC_DRAW);
         glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         /* Note cached material index. */
 
-        mp->mtrl = draw->base->mtrls[mi];
+        mp->base = kp;
+        mp->mtrl = base->mtrls[kp->mi];
 
-        mp->ebc = gn * 3;
-        mp->vbc = vn;
+        mp->ebc = kp->qc * 3;
+        mp->vbc = kp->yc;
+    }
+
+    /* Find the bounding box. Point sprites overhang theirs, so skip them. */
+
+    if (!(mtrl_get(mp->mtrl)->base.fl & M_PARTICLE) && kp->yc > 0)
+    {
+        const struct b_attr *yv = base->yv + kp->y0;
+        int yi;
+
+        v_cpy(mp->bb + 0, yv[0].p);
+        v_cpy(mp->bb + 3, yv[0].p);
+
+        for (yi = 1; yi < kp->yc; yi++)
+        {
+            mp->bb[0] = MIN(mp->bb[0], yv[yi].p[0]);
+            mp->bb[1] = MIN(mp->bb[1], yv[yi].p[1]);
+            mp->bb[2] = MIN(mp->bb[2], yv[yi].p[2]);
+            mp->bb[3] = MAX(mp->bb[3], yv[yi].p[0]);
+            mp->bb[4] = MAX(mp->bb[4], yv[yi].p[1]);
+            mp->bb[5] = MAX(mp->bb[5], yv[yi].p[2]);
+        }
+        mp->cull = 1;
     }
 
-    free(iv);
     free(gv);
-    free(vv);
 }
 
 static void sol_free_mesh(struct d_mesh *mp)
@@ -389,15 +598,34 @@ static void sol_free_mesh(struct d_mesh *mp)
     glDeleteBuffers_(1, &mp->vbo);
 }
 
+static void sol_point_mesh(void)
+{
+    const size_t s = sizeof (struct d_vert);
+    const GLenum T = GL_FLOAT;
+
+    /* Point the vertex arrays at the bound d_vert buffer. */
+
+    glVertexPointer  (3, T, s, (GLvoid *) offsetof (struct d_vert, p));
+    glNormalPointer  (   T, s, (GLvoid *) offsetof (struct d_vert, n));
+
+    if (tex_env_stage(TEX_STAGE_SHADOW))
+    {
+        glTexCoordPointer(3, T, s, (GLvoid *) offsetof (struct d_vert, p));
+
+        if (tex_env_stage(TEX_STAGE_CLIP))
+            glTexCoordPointer(3, T, s, (GLvoid *) offsetof (struct d_vert, p));
+
+        tex_env_stage(TEX_STAGE_TEXTURE);
+    }
+    glTexCoordPointer(2, T, s, (GLvoid *) offsetof (struct d_vert, t));
+}
+
 void sol_draw_mesh(const struct d_mesh *mp, struct s_rend *rend, int p)
 {
     /* If this mesh has material matching the given flags... */
 
     if (sol_test_mtrl(mp->mtrl, p))
     {
-        const size_t s = sizeof (struct d_vert);
-        const GLenum T = GL_FLOAT;
-
         /* Apply the material state. */
 
         r_apply_mtrl(rend, mp->mtrl);
@@ -407,26 +635,20 @@ void sol_draw_mesh(const struct d_mesh *mp, struct s_rend *rend, int p)
         glBindBuffer_(GL_ARRAY_BUFFER,         mp->vbo);
         glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, mp->ebo);
 
-        glVertexPointer  (3, T, s, (GLvoid *) offsetof (struct d_vert, p));
-        glNormalPointer  (   T, s, (GLvoid *) offsetof (struct d_vert, n));
-
-        if (tex_env_stage(TEX_STAGE_SHADOW))
-        {
-            glTexCoordPointer(3, T, s, (GLvoid *) offsetof (struct d_vert, p));
-
-            if (tex_env_stage(TEX_STAGE_CLIP))
-                glTexCoordPointer(3, T, s, (GLvoid *) offsetof (struct d_vert, p));
-
-            tex_env_stage(TEX_STAGE_TEXTURE);
-        }
-        glTexCoordPointer(2, T, s, (GLvoid *) offsetof (struct d_vert, t));
+        sol_point_mesh();
 
         /* Draw the mesh. */
 
         if (rend->curr_mtrl.base.fl & M_PARTICLE)
             glDrawArrays(GL_POINTS, 0, mp->vbc);
         else
+        {
             glDrawElements(GL_TRIANGLES, mp->ebc, GL_UNSIGNED_SHORT, 0);
+            rend->count.tris += mp->ebc / 3;
+        }
+
+        rend->count.drawn++;
+        rend->count.draw_calls++;
     }
 }
 
@@ -436,26 +658,29 @@ static void sol_load_body(struct d_body *bp,
                           const struct b_body *bq,
                           const struct s_draw *draw)
 {
-    int mi;
+    const struct s_base *base = draw->base;
+    const int bi = bq - base->bv;
+
+    int ki, mi;
 
     bp->base = bq;
     bp->mc   =  0;
 
-    /* Determine how many materials this body uses. */
+    /* Determine how many meshes this body has. */
 
-    for (mi = 0; mi < draw->base->mc; ++mi)
-        if (sol_count_body(bq, draw->base, mi))
+    for (ki = 0; ki < base->kc; ++ki)
+        if (base->kv[ki].bi == bi)
             bp->mc++;
 
-    /* Allocate and initialize a mesh for each material. */
+    /* Upload each of them. */
 
     if ((bp->mv = (struct d_mesh *) calloc(bp->mc, sizeof (struct d_mesh))))
     {
         int mj = 0;
 
-        for (mi = 0; mi < draw->base->mc; ++mi)
-            if (sol_count_body(bq, draw->base, mi))
-                sol_load_mesh(bp->mv + mj++, bq, draw, mi);
+        for (ki = 0; ki < base->kc; ++ki)
+            if (base->kv[ki].bi == bi)
+                sol_load_mesh(bp->mv + mj++, base->kv + ki, draw);
     }
 
     /* Cache a mesh count for each pass. */
@@ -465,6 +690,29 @@ static void sol_load_body(struct d_body *bp,
     bp->pass[2] = sol_count_mesh(bp, 2);
     bp->pass[3] = sol_count_mesh(bp, 3);
     bp->pass[4] = sol_count_mesh(bp, 4);
+
+    /* Bound the body by its meshes, unless any of them is unbounded. */
+
+    bp->cull = (bp->mv && bp->mc > 0);
+
+    for (mi = 0; mi < bp->mc && bp->cull; ++mi)
+    {
+        const struct d_mesh *mp = bp->mv + mi;
+
+        if (mp->cull == 0)
+            bp->cull = 0;
+        else if (mi == 0)
+            memcpy(bp->bb, mp->bb, sizeof (bp->bb));
+        else
+        {
+            bp->bb[0] = MIN(bp->bb[0], mp->bb[0]);
+            bp->bb[1] = MIN(bp->bb[1], mp->bb[1]);
+            bp->bb[2] = MIN(bp->bb[2], mp->bb[2]);
+            bp->bb[3] = MAX(bp->bb[3], mp->bb[3]);
+            bp->bb[4] = MAX(bp->bb[4], mp->bb[4]);
+            bp->bb[5] = MAX(bp->bb[5], mp->bb[5]);
+        }
+    }
 }
 
 static void sol_free_body(struct d_body *bp)
@@ -477,12 +725,66 @@ static void sol_free_body(struct d_body *bp)
     free(bp->mv);
 }
 
-static void sol_draw_body(const struct d_body *bp, struct s_rend *rend, int p)
+/*---------------------------------------------------------------------------*/
+
+static int sol_item_cmp(const void *a, const void *b)
 {
-    int i;
+    const struct d_item *ip = (const struct d_item *) a;
+    const struct d_item *iq = (const struct d_item *) b;
 
-    for (i = 0; i < bp->mc; ++i)
-        sol_draw_mesh(bp->mv + i, rend, p);
+    /* Order by material, then by body, then by mesh within the body. */
+
+    if (ip->mp->mtrl != iq->mp->mtrl)
+        return ip->mp->mtrl < iq->mp->mtrl ? -1 : +1;
+    if (ip->bp != iq->bp)
+        return ip->bp < iq->bp ? -1 : +1;
+    if (ip->mp != iq->mp)
+        return ip->mp < iq->mp ? -1 : +1;
+
+    return 0;
+}
+
+static void sol_load_list(struct s_draw *draw)
+{
+    int bi, mi, p, c = 0;
+
+    /* Count the meshes of each pass. */
+
+    for (p = 0; p < PASS_MAX; p++)
+    {
+        draw->ic[p] = c;
+
+        for (bi = 0; bi < draw->bc; bi++)
+            c += draw->bv[bi].pass[p];
+    }
+    draw->ic[PASS_MAX] = c;
+
+    /* List them in body order, then sort the opaque passes by material. */
+
+    if (c && (draw->iv = (struct d_item *) calloc(c, sizeof (struct d_item))))
+    {
+        for (p = 0; p < PASS_MAX; p++)
+        {
+            struct d_item *ip = draw->iv + draw->ic[p];
+
+            for (bi = 0; bi < draw->bc; bi++)
+                for (mi = 0; mi < draw->bv[bi].mc; mi++)
+                    if (sol_test_mtrl(draw->bv[bi].mv[mi].mtrl, p))
+                    {
+                        ip->bp = draw->bv + bi;
+                        ip->mp = draw->bv[bi].mv + mi;
+                        ip++;
+                    }
+
+            /* Blended passes keep body order, as the result depends on it. */
+
+            if (p != PASS_TRANSPARENT_DECAL && p != PASS_TRANSPARENT)
+                qsort(draw->iv + draw->ic[p], draw->ic[p + 1] - draw->ic[p],
+                      sizeof (struct d_item), sol_item_cmp);
+        }
+    }
+    else
+        memset(draw->ic, 0, sizeof (draw->ic));
 }
 
 /*---------------------------------------------------------------------------*/
@@ -514,6 +816,11 @@ int sol_load_draw(struct s_draw *draw, struct s_vary *vary, int s)
     draw->shadow_ui = -1;
     draw->shadowed = s;
 
+    /* Assemble meshes for files that were compiled without them. */
+
+    if (draw->base->kc == 0)
+        sol_mesh_base(draw->base);
+
     /* Initialize all bodies for this file. */
 
     if (draw->base->bc)
@@ -527,8 +834,14 @@ int sol_load_draw(struct s_draw *draw, struct s_vary *vary, int s)
         }
     }
 
+    /* Assemble the per-pass draw list. */
+
+    sol_load_list(draw);
+
     sol_load_bill(draw);
 
+    glGenBuffers_(1, &draw->inst);
+
     return 1;
 }
 
@@ -540,40 +853,99 @@ void sol_free_draw(struct s_draw *draw)
 
     sol_free_bill(draw);
 
+    glDeleteBuffers_(1, &draw->inst);
+
     for (i = 0; i < draw->bc; i++)
         sol_free_body(draw->bv + i);
 
+    free(draw->iv);
     free(draw->bv);
 }
 
-/*---------------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+
+static void sol_cull_all(const struct s_draw *draw,
+                         const struct s_rend *rend, const float *V)
+{
+    int bi;
+
+    /* Note the clip planes and visibility of each body in this view. */
+
+    for (bi = 0; bi < draw->bc; ++bi)
+    {
+        struct d_body *bp = draw->bv + bi;
+
+        bp->vis = 1;
+
+        if (bp->cull)
+        {
+            float B[16];
+
+            sol_clip_body(B, V, draw->vary, draw->vary->bv + bi);
+            sol_cull_body(bp->P, B, rend->clip);
+
+            if (sol_cull_test(bp->P[0], bp->bb))
+                bp->vis = 0;
+        }
+    }
+}
+
+static void sol_draw_all(const struct s_draw *draw, struct s_rend *rend, int p)
+{
+    const struct d_body *bq = NULL;
+    int ii;
+
+    /* Walk the draw list of the given pass, skipping culled meshes. */
+
+    glPushMatrix();
+
+    for (ii = draw->ic[p]; ii < draw->ic[p + 1]; ++ii)
+    {
+        const struct d_body *bp = draw->iv[ii].bp;
+        const struct d_mesh *mp = draw->iv[ii].mp;
+
+        /* A single mesh shares the box already tested for its body. */
 
-static void sol_draw_all(const struct s_draw *draw, struct s_rend *rend, int p)
-{
-    int bi;
+        if (!bp->vis || (bp->cull && bp->mc > 1 &&
+                         sol_cull_test(bp->P[0], mp->bb)))
+        {
+            rend->count.culled++;
+            continue;
+        }
 
-    /* Draw all meshes of all bodies matching the given material flags. */
+        /* Apply the body transform when the body changes. */
 
-    for (bi = 0; bi < draw->bc; ++bi)
-        if (draw->bv[bi].pass[p])
+        if (bp != bq)
         {
-            glPushMatrix();
-            {
-                sol_transform(draw->vary, draw->vary->bv + bi, draw->shadow_ui);
-                sol_draw_body(draw->bv + bi, rend, p);
-            }
             glPopMatrix();
+            glPushMatrix();
+
+            sol_transform(draw->vary, draw->vary->bv + (bp - draw->bv),
+                          draw->shadow_ui);
+            bq = bp;
         }
+
+        sol_draw_mesh(mp, rend, p);
+    }
+
+    glPopMatrix();
 }
 
 /*---------------------------------------------------------------------------*/
 
 void sol_draw(const struct s_draw *draw, struct s_rend *rend, int mask, int test)
 {
+    float V[16];
+
     /* Disable shadowed material setup if not requested. */
 
     rend->skip_flags |= (draw->shadowed ? 0 : M_SHADOWED);
 
+    /* Note the view for frustum culling. */
+
+    sol_cull_view(V);
+    sol_cull_all(draw, rend, V);
+
     /* Render all opaque geometry, decals last. */
 
     sol_draw_all(draw, rend, PASS_OPAQUE);
@@ -600,10 +972,17 @@ void sol_draw(const struct s_draw *draw, struct s_rend *rend, int mask, int test
 
 void sol_refl(const struct s_draw *draw, struct s_rend *rend)
 {
+    float V[16];
+
     /* Disable shadowed material setup if not requested. */
 
     rend->skip_flags |= (draw->shadowed ? 0 : M_SHADOWED);
 
+    /* Note the view for frustum culling. */
+
+    sol_cull_view(V);
+    sol_cull_all(draw, rend, V);
+
     /* Render all reflective geometry. */
 
     sol_draw_all(draw, rend, PASS_REFLECTIVE);
@@ -616,120 +995,373 @@ void sol_refl(const struct s_draw *draw, struct s_rend *rend)
     rend->skip_flags = 0;
 }
 
+static void sol_refl_point(float *r, const float *B, const float *v)
+{
+    float x = B[0] * v[0] + B[4] * v[1] + B[8]  * v[2] + B[12];
+    float y = B[1] * v[0] + B[5] * v[1] + B[9]  * v[2] + B[13];
+    float w = B[3] * v[0] + B[7] * v[1] + B[11] * v[2] + B[15];
+
+    /* A point behind the eye may land anywhere on screen. */
+
+    if (w > 0.0f)
+    {
+        r[0] = MIN(r[0], x / w);
+        r[1] = MIN(r[1], y / w);
+        r[2] = MAX(r[2], x / w);
+        r[3] = MAX(r[3], y / w);
+    }
+    else
+    {
+        r[0] = r[1] = -1.0f;
+        r[2] = r[3] = +1.0f;
+    }
+}
+
+/*
+ * Find the screen rectangle covered by reflective meshes in the current
+ * view, in normalized device coordinates.  Return the number of meshes
+ * in view, zero if the mirrored pass may be skipped.
+ */
+
+int sol_refl_bound(const struct s_draw *draw, float *r)
+{
+    const struct d_body *bq = NULL;
+
+    float V[16];
+    float B[16];
+    float P[6][4];
+
+    const int p = PASS_REFLECTIVE;
+
+    int ii, n = 0;
+
+    static const float full[4] = { -1.0f, -1.0f, +1.0f, +1.0f };
+
+    sol_cull_view(V);
+
+    r[0] = r[1] = +1.0f;
+    r[2] = r[3] = -1.0f;
+
+    for (ii = draw->ic[p]; ii < draw->ic[p + 1]; ++ii)
+    {
+        const struct d_body *bp = draw->iv[ii].bp;
+        const struct d_mesh *mp = draw->iv[ii].mp;
+
+        int i;
+
+        /* Without a usable box, assume the mirror fills the screen. */
+
+        if (!mp->cull)
+        {
+            memcpy(r, full, sizeof (full));
+            return n + 1;
+        }
+
+        if (bp != bq)
+        {
+            const struct v_body *vp = draw->vary->bv + (bp - draw->bv);
+
+            sol_clip_body(B, V, draw->vary, vp);
+            sol_cull_body(P, B, full);
+            bq = bp;
+        }
+
+        if (sol_cull_test(P[0], mp->bb))
+            continue;
+
+        for (i = 0; i < 8; i++)
+        {
+            float v[3];
+
+            v[0] = mp->bb[(i & 1) ? 3 : 0];
+            v[1] = mp->bb[(i & 2) ? 4 : 1];
+            v[2] = mp->bb[(i & 4) ? 5 : 2];
+
+            sol_refl_point(r, B, v);
+        }
+        n++;
+    }
+
+    r[0] = MAX(r[0], -1.0f);
+    r[1] = MAX(r[1], -1.0f);
+    r[2] = MIN(r[2], +1.0f);
+    r[3] = MIN(r[3], +1.0f);
+
+    return n;
+}
+
+/*
+ * Billboards are evaluated on the CPU and streamed as triangles, with one
+ * draw call for each run of billboards sharing a material.
+ */
+
+static void sol_bill_rot(float *M, float a, float x, float y, float z)
+{
+    const float v[3] = { x, y, z };
+
+    float R[16];
+    float T[16];
+
+    /* Post-multiply by a rotation, as glRotatef does. */
+
+    if (a)
+    {
+        m_rot(R, v, V_RAD(a));
+        m_cpy(T, M);
+        m_mult(M, T, R);
+    }
+}
+
+static void sol_bill_xlt(float *M, const float *p)
+{
+    float X[16];
+    float T[16];
+
+    m_xlt(X, p);
+    m_cpy(T, M);
+    m_mult(M, T, X);
+}
+
+static struct bill_vert *sol_bill_quad(struct bill_vert *vv, const float *M,
+                                       float w, float h, int edge)
+{
+    static const int c[6] = { 0, 1, 2, 2, 1, 3 };
+
+    int i;
+
+    /* Emit the billboard strip as two triangles of the same winding. */
+
+    for (i = 0; i < 6; i++, vv++)
+    {
+        const float s = (float) (c[i] & 1);
+        const float t = (float) (c[i] >> 1);
+
+        float v[3];
+
+        v[0] = (s - 0.5f) * w;
+        v[1] = (edge ? t : t - 0.5f) * h;
+        v[2] = 0.0f;
+
+        vv->t[0] = s;
+        vv->t[1] = t;
+
+        m_pxfm(vv->p, M, v);
+    }
+    return vv;
+}
+
+static void sol_bill_stream(const struct s_draw *draw, struct s_rend *rend,
+                            const struct bill_vert *vv, const int *mv, int n)
+{
+    const size_t s = sizeof (struct bill_vert);
+    const GLenum T = GL_FLOAT;
+
+    int i, j;
+
+    /* Upload all quads, then draw them a material run at a time. */
+
+    glBindBuffer_(GL_ARRAY_BUFFER, draw->inst);
+    glBufferData_(GL_ARRAY_BUFFER, n * 6 * s, vv, GL_STREAM_DRAW);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+    glTexCoordPointer(2, T, s, (GLvoid *) offsetof (struct bill_vert, t));
+    glVertexPointer  (3, T, s, (GLvoid *) offsetof (struct bill_vert, p));
+
+    for (i = 0; i < n; i = j)
+    {
+        for (j = i + 1; j < n && mv[j] == mv[i]; j++)
+            ;
+
+        r_apply_mtrl(rend, mv[i]);
+
+        glDrawArrays(GL_TRIANGLES, i * 6, (j - i) * 6);
+
+        rend->count.draw_calls++;
+        rend->count.tris += (j - i) * 2;
+    }
+
+    sol_bill_disable();
+}
+
 void sol_back(const struct s_draw *draw,
               struct s_rend *rend,
               float n, float f, float t)
 {
-    if (!(draw && draw->base && draw->base->rc))
+    const struct s_base *base;
+
+    struct d_bill *bs;
+    struct bill_vert *vp;
+
+    const float *w, *h, *rx, *ry, *rz;
+
+    int ri, rc, c = 0;
+
+    if (!(draw && draw->base && (bs = draw->bs)))
         return;
 
-    glDisable(GL_LIGHTING);
-    glDepthMask(GL_FALSE);
+    base = draw->base;
+    rc   = bs->rc;
+
+    /* Evaluate the size and rotation polynomials of all billboards. */
 
-    sol_bill_enable(draw);
+    for (ri = 0; ri < rc; ri++)
     {
-        int ri;
+        const float p = bs->tv[ri];
+        const float T = (p > 0.0f) ? (fmodf(t, p) - p / 2) : 0;
 
-        /* Consider each billboard. */
+        bs->av[ri]      = T;
+        bs->av[ri + rc] = T * T;
+    }
 
-        for (ri = 0; ri < draw->base->rc; ri++)
-        {
-            const struct b_bill *rp = draw->base->rv + ri;
+    sol_bill_eval(bs);
 
-            /* Render only billboards at distances between n and f. */
+    w  = bs->ev + BILL_W  * rc;
+    h  = bs->ev + BILL_H  * rc;
+    rx = bs->ev + BILL_RX * rc;
+    ry = bs->ev + BILL_RY * rc;
+    rz = bs->ev + BILL_RZ * rc;
 
-            if (n <= rp->d && rp->d < f)
-            {
-                float T = (rp->t > 0.0f) ? (fmodf(t, rp->t) - rp->t / 2) : 0;
+    /* Generate those between n and f that face the viewer. */
 
-                float w = rp->w[0] + rp->w[1] * T + rp->w[2] * T * T;
-                float h = rp->h[0] + rp->h[1] * T + rp->h[2] * T * T;
+    vp = bs->vv;
 
-                /* Render only billboards facing the viewer. */
+    for (ri = 0; ri < rc; ri++)
+    {
+        const struct b_bill *rp = base->rv + ri;
 
-                if (w > 0 && h > 0)
-                {
-                    float rx = rp->rx[0] + rp->rx[1] * T + rp->rx[2] * T * T;
-                    float ry = rp->ry[0] + rp->ry[1] * T + rp->ry[2] * T * T;
-                    float rz = rp->rz[0] + rp->rz[1] * T + rp->rz[2] * T * T;
+        if (n <= rp->d && rp->d < f && w[ri] > 0 && h[ri] > 0)
+        {
+            const float d[3] = { 0.0f, 0.0f, -rp->d };
 
-                    r_apply_mtrl(rend, draw->base->mtrls[rp->mi]);
+            float M[16];
 
-                    glPushMatrix();
-                    {
-                        if (ry) glRotatef(ry, 0.0f, 1.0f, 0.0f);
-                        if (rx) glRotatef(rx, 1.0f, 0.0f, 0.0f);
+            m_ident(M);
 
-                        glTranslatef(0.0f, 0.0f, -rp->d);
+            sol_bill_rot(M, ry[ri], 0.0f, 1.0f, 0.0f);
+            sol_bill_rot(M, rx[ri], 1.0f, 0.0f, 0.0f);
+            sol_bill_xlt(M, d);
 
-                        if (rp->fl & B_FLAT)
-                        {
-                            glRotatef(-rx - 90.0f, 1.0f, 0.0f, 0.0f);
-                            glRotatef(-ry,         0.0f, 0.0f, 1.0f);
-                        }
-                        if (rp->fl & B_EDGE)
-                            glRotatef(-rx,         1.0f, 0.0f, 0.0f);
+            if (rp->fl & B_FLAT)
+            {
+                sol_bill_rot(M, -rx[ri] - 90.0f, 1.0f, 0.0f, 0.0f);
+                sol_bill_rot(M, -ry[ri],         0.0f, 0.0f, 1.0f);
+            }
+            if (rp->fl & B_EDGE)
+                sol_bill_rot(M, -rx[ri],         1.0f, 0.0f, 0.0f);
 
-                        if (rz) glRotatef(rz, 0.0f, 0.0f, 1.0f);
+            sol_bill_rot(M, rz[ri], 0.0f, 0.0f, 1.0f);
 
-                        glScalef(w, h, 1.0f);
+            vp = sol_bill_quad(vp, M, w[ri], h[ri], rp->fl & B_EDGE);
 
-                        sol_draw_bill(rp->fl & B_EDGE);
-                    }
-                    glPopMatrix();
-                }
-            }
+            bs->mv[c++] = base->mtrls[rp->mi];
         }
     }
-    sol_bill_disable();
 
-    glDepthMask(GL_TRUE);
-    glEnable(GL_LIGHTING);
+    if (c)
+    {
+        glDisable(GL_LIGHTING);
+        glDepthMask(GL_FALSE);
+        {
+            sol_bill_stream(draw, rend, bs->vv, bs->mv, c);
+        }
+        glDepthMask(GL_TRUE);
+        glEnable(GL_LIGHTING);
+    }
 }
 
-void sol_bill(const struct s_draw *draw,
-              struct s_rend *rend, const float *M, float t)
+void sol_bill_inst(const struct s_draw *draw,
+                   struct s_rend *rend, const float *M, float t,
+                   const float *pv, int pc, float k)
 {
-    if (!(draw && draw->base && draw->base->rc))
+    const struct s_base *base;
+
+    struct d_bill *bs;
+    struct bill_vert *vp;
+
+    const float *w, *h, *rx, *ry, *rz;
+
+    int ri, rc, c = 0;
+
+    if (!(draw && draw->base && (bs = draw->bs)) || pc <= 0)
+        return;
+
+    if (!sol_grow_bill_eval(bs, pc))
         return;
 
-    sol_bill_enable(draw);
+    base = draw->base;
+    rc   = bs->rc;
+
+    /* Evaluate the size and rotation functions of all billboards. */
+
+    for (ri = 0; ri < rc; ri++)
     {
-        int ri;
+        const float T = bs->tv[ri] * t;
 
-        for (ri = 0; ri < draw->base->rc; ++ri)
-        {
-            const struct b_bill *rp = draw->base->rv + ri;
+        bs->av[ri]      = T;
+        bs->av[ri + rc] = fsinf(T);
+    }
 
-            float T = rp->t * t;
-            float S = fsinf(T);
+    sol_bill_eval(bs);
 
-            float w  = rp->w [0] + rp->w [1] * T + rp->w [2] * S;
-            float h  = rp->h [0] + rp->h [1] * T + rp->h [2] * S;
-            float rx = rp->rx[0] + rp->rx[1] * T + rp->rx[2] * S;
-            float ry = rp->ry[0] + rp->ry[1] * T + rp->ry[2] * S;
-            float rz = rp->rz[0] + rp->rz[1] * T + rp->rz[2] * S;
+    w  = bs->ev + BILL_W  * rc;
+    h  = bs->ev + BILL_H  * rc;
+    rx = bs->ev + BILL_RX * rc;
+    ry = bs->ev + BILL_RY * rc;
+    rz = bs->ev + BILL_RZ * rc;
 
-            r_apply_mtrl(rend, draw->base->mtrls[rp->mi]);
+    /* Generate each billboard, then copy it to each instance. */
 
-            glPushMatrix();
-            {
-                glTranslatef(rp->p[0], rp->p[1], rp->p[2]);
+    vp = bs->vv;
+
+    for (ri = 0; ri < rc; ri++)
+    {
+        const struct b_bill *rp = base->rv + ri;
+
+        struct bill_vert q[6];
+
+        float B[16];
+        int i, j;
+
+        m_ident(B);
+
+        sol_bill_xlt(B, rp->p);
 
-                if (M && ((rp->fl & B_NOFACE) == 0)) glMultMatrixf(M);
+        if (M && ((rp->fl & B_NOFACE) == 0))
+        {
+            float T[16];
+
+            m_cpy(T, B);
+            m_mult(B, T, M);
+        }
+
+        sol_bill_rot(B, rx[ri], 1.0f, 0.0f, 0.0f);
+        sol_bill_rot(B, ry[ri], 0.0f, 1.0f, 0.0f);
+        sol_bill_rot(B, rz[ri], 0.0f, 0.0f, 1.0f);
 
-                if (fabsf(rx) > 0.0f) glRotatef(rx, 1.0f, 0.0f, 0.0f);
-                if (fabsf(ry) > 0.0f) glRotatef(ry, 0.0f, 1.0f, 0.0f);
-                if (fabsf(rz) > 0.0f) glRotatef(rz, 0.0f, 0.0f, 1.0f);
+        sol_bill_quad(q, B, w[ri], h[ri], 0);
 
-                glScalef(w, h, 1.0f);
+        for (i = 0; i < pc; i++, vp += 6)
+        {
+            for (j = 0; j < 6; j++)
+            {
+                vp[j] = q[j];
 
-                sol_draw_bill(GL_FALSE);
+                if (pv)
+                    v_mad(vp[j].p, pv + i * 3, q[j].p, k);
             }
-            glPopMatrix();
+            bs->mv[c++] = base->mtrls[rp->mi];
         }
     }
-    sol_bill_disable();
+
+    if (c)
+        sol_bill_stream(draw, rend, bs->vv, bs->mv, c);
+}
+
+void sol_bill(const struct s_draw *draw,
+              struct s_rend *rend, const float *M, float t)
+{
+    sol_bill_inst(draw, rend, M, t, NULL, 1, 1.0f);
 }
 
 void sol_fade(const struct s_draw *draw, struct s_rend *rend, float k)
@@ -752,7 +1384,7 @@ void sol_fade(const struct s_draw *draw, struct s_rend *rend, float k)
             sol_bill_enable(draw);
             r_apply_mtrl(rend, default_mtrl);
             glScalef(2.0f, 2.0f, 1.0f);
-            sol_draw_bill(GL_FALSE);
+            sol_draw_bill(rend, GL_FALSE);
             sol_bill_disable();
 
             glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
@@ -770,6 +1402,170 @@ void sol_fade(const struct s_draw *draw, struct s_rend *rend, float k)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Instanced drawing. Each mesh is transformed once on the CPU, copied to
+ * every instance position in a buffer streamed per call, and drawn with a
+ * single call however many instances there are.
+ */
+
+static struct d_vert *inst_vv;          /* Instance scratch space */
+static int            inst_vm;
+
+static int sol_inst_size(const struct d_mesh *mp)
+{
+    /* Point sprites draw their vertices, others expand their triangles. */
+
+    if (mtrl_get(mp->mtrl)->base.fl & M_PARTICLE)
+        return mp->base->yc;
+    else
+        return mp->base->qc * 3;
+}
+
+static void sol_inst_vert(struct d_vert *vp, const struct d_vert *tp,
+                          const float *p)
+{
+    *vp = *tp;
+
+    v_add(vp->p, tp->p, p);
+}
+
+static void sol_inst_mesh(const struct s_draw *draw,
+                          struct s_rend *rend,
+                          const struct d_item *ip,
+                          struct d_vert *vv,
+                          struct d_vert *tv,
+                          const float *pv, int pc, float k)
+{
+    const struct b_mesh *kp = ip->mp->base;
+    const struct b_attr *yv = draw->base->yv + kp->y0;
+    const struct b_elem *qv = draw->base->qv + kp->q0;
+
+    const int pt = (mtrl_get(ip->mp->mtrl)->base.fl & M_PARTICLE) ? 1 : 0;
+
+    float M[16];
+    int c = 0, i, j;
+
+    /* Transform the mesh vertices by the body and the scale, once. */
+
+    sol_body_matrix(M, draw->vary, draw->vary->bv + (ip->bp - draw->bv));
+
+    for (j = 0; j < kp->yc; j++)
+    {
+        m_pxfm(tv[j].p, M, yv[j].p);
+        m_vxfm(tv[j].n, M, yv[j].n);
+
+        v_scl(tv[j].p, tv[j].p, k);
+
+        tv[j].t[0] = yv[j].t[0];
+        tv[j].t[1] = yv[j].t[1];
+    }
+
+    /* Copy them to each instance position. */
+
+    for (i = 0; i < pc; i++, pv += 3)
+    {
+        if (pt)
+            for (j = 0; j < kp->yc; j++)
+                sol_inst_vert(vv + c++, tv + j, pv);
+        else
+            for (j = 0; j < kp->qc; j++)
+            {
+                sol_inst_vert(vv + c++, tv + qv[j].yi, pv);
+                sol_inst_vert(vv + c++, tv + qv[j].yj, pv);
+                sol_inst_vert(vv + c++, tv + qv[j].yk, pv);
+            }
+    }
+
+    /* Stream the vertices and draw them all at once. */
+
+    r_apply_mtrl(rend, ip->mp->mtrl);
+
+    glBufferData_(GL_ARRAY_BUFFER, c * sizeof (struct d_vert), vv,
+                  GL_STREAM_DRAW);
+
+    sol_point_mesh();
+
+    glDrawArrays(pt ? GL_POINTS : GL_TRIANGLES, 0, c);
+
+    rend->count.drawn += pc;
+    rend->count.draw_calls++;
+    rend->count.tris  += pt ? 0 : c / 3;
+}
+
+static void sol_inst_pass(const struct s_draw *draw,
+                          struct s_rend *rend, int p,
+                          struct d_vert *vv,
+                          struct d_vert *tv,
+                          const float *pv, int pc, float k)
+{
+    int ii;
+
+    for (ii = draw->ic[p]; ii < draw->ic[p + 1]; ++ii)
+        sol_inst_mesh(draw, rend, draw->iv + ii, vv, tv, pv, pc, k);
+}
+
+int sol_draw_inst(const struct s_draw *draw, struct s_rend *rend,
+                  const float *pv, int pc, float k)
+{
+    struct d_vert *vv;
+    struct d_vert *tv;
+
+    int ii, vc = 0, tc = 0;
+
+    /* Find scratch space for the largest mesh. */
+
+    for (ii = 0; ii < draw->ic[PASS_MAX]; ++ii)
+    {
+        vc = MAX(vc, sol_inst_size(draw->iv[ii].mp));
+        tc = MAX(tc, draw->iv[ii].mp->base->yc);
+    }
+
+    if (pc <= 0 || vc == 0)
+        return 1;
+
+    /* The scratch space is kept from frame to frame and grows as needed. */
+
+    if (vc * pc + tc > inst_vm)
+    {
+        if (!(vv = (struct d_vert *) realloc(inst_vv, (vc * pc + tc) *
+                                             sizeof (*vv))))
+            return 0;
+
+        inst_vv = vv;
+        inst_vm = vc * pc + tc;
+    }
+
+    vv = inst_vv;
+    tv = vv + vc * pc;
+
+    /* Disable shadowed material setup if not requested. */
+
+    rend->skip_flags |= (draw->shadowed ? 0 : M_SHADOWED);
+
+    glBindBuffer_(GL_ARRAY_BUFFER,         draw->inst);
+    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    /* Render opaque geometry, then transparent without depth writes. */
+
+    sol_inst_pass(draw, rend, PASS_OPAQUE,            vv, tv, pv, pc, k);
+    sol_inst_pass(draw, rend, PASS_OPAQUE_DECAL,      vv, tv, pv, pc, k);
+
+    glDepthMask(GL_FALSE);
+    {
+        sol_inst_pass(draw, rend, PASS_TRANSPARENT_DECAL, vv, tv, pv, pc, k);
+        sol_inst_pass(draw, rend, PASS_TRANSPARENT,       vv, tv, pv, pc, k);
+    }
+    glDepthMask(GL_TRUE);
+
+    glBindBuffer_(GL_ARRAY_BUFFER, 0);
+
+    rend->skip_flags = 0;
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
 int sol_load_full(struct s_full *full, const char *filename, int s)
 {
     if (full)
@@ -835,6 +1631,16 @@ static void assert_mtrl(const struct mtrl *mp)
 }
 #endif
 
+void r_clip_rect(struct s_rend *rend, const float *r)
+{
+    /* Restrict culling to a rectangle of the view, or the whole view. */
+
+    rend->clip[0] = r ? r[0] : -1.0f;
+    rend->clip[1] = r ? r[1] : -1.0f;
+    rend->clip[2] = r ? r[2] : +1.0f;
+    rend->clip[3] = r ? r[3] : +1.0f;
+}
+
 void r_color_mtrl(struct s_rend *rend, int enable)
 {
     if (enable)
@@ -875,7 +1681,10 @@ void r_apply_mtrl(struct s_rend *rend, int mi)
     /* Bind the texture. */
 
     if (mp->o != mq->o)
+    {
         glBindTexture(GL_TEXTURE_2D, mp->o);
+        rend->count.tex_binds++;
+    }
 
     /* Set material properties. */
 
@@ -1007,6 +1816,12 @@ void r_apply_mtrl(struct s_rend *rend, int mi)
 
     /* Update current material state. */
 
+    if (rend->curr_mi != mi)
+    {
+        rend->curr_mi = mi;
+        rend->count.mtrl_binds++;
+    }
+
     memcpy(mq, mp, sizeof (struct mtrl));
 
     mq->base.fl = mp_flags;
@@ -1023,12 +1838,24 @@ void r_draw_enable(struct s_rend *rend)
     glBindTexture(GL_TEXTURE_2D, 0);
 
     rend->curr_mtrl = *mtrl_get(default_mtrl);
+    rend->curr_mi   = default_mtrl;
+
+    r_clip_rect(rend, NULL);
 }
 
 void r_draw_disable(struct s_rend *rend)
 {
     r_apply_mtrl(rend, default_mtrl);
 
+    /* Add this pass's counters to the running totals. */
+
+    r_total.drawn      += rend->count.drawn;
+    r_total.culled     += rend->count.culled;
+    r_total.mtrl_binds += rend->count.mtrl_binds;
+    r_total.tex_binds  += rend->count.tex_binds;
+    r_total.draw_calls += rend->count.draw_calls;
+    r_total.tris       += rend->count.tris;
+
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
     glDisableClientState(GL_NORMAL_ARRAY);
     glDisableClientState(GL_VERTEX_ARRAY);
@@ -58,12 +58,17 @@ struct d_geom
 
 struct d_mesh
 {
+    const struct b_mesh *base;
+
     int mtrl;                                  /* Cached material            */
 
     GLuint vbo;                                /* Vertex  buffer object      */
     GLuint vbc;                                /* Vertex  buffer count       */
     GLuint ebo;                                /* Element buffer object      */
     GLuint ebc;                                /* Element buffer count       */
+
+    float bb[6];                               /* Bounding box (min, max)    */
+    unsigned int cull:1;                       /* Bounding box is usable     */
 };
 
 struct d_body
@@ -73,9 +78,23 @@ struct d_body
     int pass[PASS_MAX];
     int mc;
 
+    float bb[6];
+    unsigned int cull:1;
+
+    float P[6][4];
+    unsigned int vis:1;
+
     struct d_mesh *mv;
 };
 
+struct d_item
+{
+    const struct d_body *bp;
+    const struct d_mesh *mp;
+};
+
+struct d_bill;
+
 struct s_draw
 {
     struct s_base *base;
@@ -85,7 +104,14 @@ struct s_draw
 
     struct d_body *bv;
 
+    int ic[PASS_MAX + 1];
+
+    struct d_item *iv;
+
     GLuint bill;
+    GLuint inst;
+
+    struct d_bill *bs;                         /* Billboard scratch space    */
 
     unsigned int reflective:1;
     unsigned int shadowed:1;
@@ -95,6 +121,23 @@ struct s_draw
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Rendering counters, kept per s_rend and summed into r_total by
+ * r_draw_disable.
+ */
+
+struct r_count
+{
+    int drawn;                          /* Meshes drawn                      */
+    int culled;                         /* Meshes culled                     */
+    int mtrl_binds;                     /* Material changes                  */
+    int tex_binds;                      /* Texture binds                     */
+    int draw_calls;                     /* Draw calls                        */
+    int tris;                           /* Triangles submitted               */
+};
+
+extern struct r_count r_total;
+
 /*
  * This structure holds rendering state shared between separate
  * SOLs. I am aware that the name leaves much to be desired.
@@ -107,11 +150,18 @@ struct s_rend
     int skip_flags;                     /* Ignored material flags            */
 
     unsigned int color_mtrl:1;          /* Color material flag               */
+
+    int curr_mi;                        /* Current material index            */
+
+    struct r_count count;               /* Counters since enable             */
+
+    float clip[4];                      /* Culling rectangle (NDC)           */
 };
 
 void r_draw_enable(struct s_rend *);
 void r_draw_disable(struct s_rend *);
 
+void r_clip_rect(struct s_rend *, const float *);
 void r_color_mtrl(struct s_rend *, int);
 void r_apply_mtrl(struct s_rend *, int);
 
@@ -122,10 +172,16 @@ void sol_free_draw(struct s_draw *);
 
 void sol_back(const struct s_draw *, struct s_rend *, float, float, float);
 void sol_refl(const struct s_draw *, struct s_rend *);
+int  sol_refl_bound(const struct s_draw *, float *);
 void sol_draw(const struct s_draw *, struct s_rend *, int, int);
 void sol_bill(const struct s_draw *, struct s_rend *, const float *, float);
+void sol_bill_inst(const struct s_draw *, struct s_rend *, const float *, float,
+                   const float *, int, float);
 void sol_fade(const struct s_draw *, struct s_rend *, float);
 
+int  sol_draw_inst(const struct s_draw *, struct s_rend *,
+                   const float *, int, float);
+
 /*---------------------------------------------------------------------------*/
 
 struct s_full
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thumb.h"
+#include "image.h"
+#include "image_async.h"
+#include "common.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Thumbnail atlas.  Level and replay screenshots are decoded once at
+ * thumbnail size into cells of a shared texture, in the background when
+ * possible, and stay there until the least recently used cell is needed
+ * for another image.  A cell shows nothing until its image arrives.
+ */
+
+struct cell
+{
+    char         path[MAXSTR];
+    unsigned int tick;                  /* Time of last use                  */
+};
+
+static GLuint       atlas;
+static int          side;
+
+static struct cell *cellv;
+static int          cellc;
+static int          cellr;              /* Cells per row                     */
+
+static void        *blank;
+static unsigned int tick;
+
+/*---------------------------------------------------------------------------*/
+
+static int thumb_init(void)
+{
+    side = THUMB_SIDE;
+
+    while (side > THUMB_SIZE && side > gli.max_texture_size)
+        side /= 2;
+
+    cellr = side / THUMB_SIZE;
+    cellc = cellr * cellr;
+
+    if ((cellv = calloc(cellc, sizeof (*cellv))) &&
+        (blank = calloc(THUMB_SIZE * THUMB_SIZE, 4)))
+    {
+        glGenTextures(1, &atlas);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, side, side, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        return 1;
+    }
+
+    thumb_quit();
+
+    return 0;
+}
+
+void thumb_quit(void)
+{
+    if (atlas)
+    {
+        image_async_drop(atlas);
+        glDeleteTextures(1, &atlas);
+    }
+
+    free(cellv);
+    free(blank);
+
+    atlas = 0;
+    cellv = NULL;
+    blank = NULL;
+    cellc = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Find the cell holding the named image, or the least recently used
+ * cell, to be loaded with it.
+ */
+static int thumb_cell(const char *path)
+{
+    int i, j = 0;
+
+    for (i = 0; i < cellc; i++)
+    {
+        if (strcmp(cellv[i].path, path) == 0)
+            return i;
+
+        if (cellv[i].tick < cellv[j].tick)
+            j = i;
+    }
+    return -1 - j;
+}
+
+/*
+ * Return the atlas texture holding a thumbnail of the named image, and
+ * its region as S0, T0, S1, T1 in UV.  Return zero for no image.
+ */
+GLuint thumb_get(const char *path, GLfloat *uv)
+{
+    int i, x, y;
+
+    if (!path || !*path || (!atlas && !thumb_init()))
+        return 0;
+
+    if ((i = thumb_cell(path)) < 0)
+    {
+        struct image_tex tex;
+
+        i = -1 - i;
+
+        x = (i % cellr) * THUMB_SIZE;
+        y = (i / cellr) * THUMB_SIZE;
+
+        SAFECPY(cellv[i].path, path);
+
+        /* Clear the cell, then load the image into it. */
+
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, THUMB_SIZE, THUMB_SIZE,
+                        GL_RGBA, GL_UNSIGNED_BYTE, blank);
+
+        if (!image_async_thumb(path, atlas, x, y, THUMB_SIZE, THUMB_SIZE))
+        {
+            if (image_load_thumb(&tex, path, THUMB_SIZE, THUMB_SIZE))
+            {
+                image_put_thumb(atlas, x, y, &tex);
+                image_count_tex(&tex);
+                free(tex.p);
+            }
+        }
+    }
+
+    cellv[i].tick = ++tick;
+
+    /* Keep samples half a texel inside the cell. */
+
+    x = (i % cellr) * THUMB_SIZE;
+    y = (i / cellr) * THUMB_SIZE;
+
+    uv[0] = (x              + 0.5f) / side;
+    uv[1] = (y              + 0.5f) / side;
+    uv[2] = (x + THUMB_SIZE - 0.5f) / side;
+    uv[3] = (y + THUMB_SIZE - 0.5f) / side;
+
+    return atlas;
+}
+
+/*---------------------------------------------------------------------------*/
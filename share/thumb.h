@@ -0,0 +1,16 @@
+#ifndef THUMB_H
+#define THUMB_H
+
+#include "glext.h"
+
+/*---------------------------------------------------------------------------*/
+
+#define THUMB_SIZE 256                  /* Thumbnail width and height        */
+#define THUMB_SIDE 2048                 /* Largest atlas width and height    */
+
+GLuint thumb_get(const char *, GLfloat *);
+void   thumb_quit(void);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
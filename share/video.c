@@ -22,6 +22,11 @@
 #include "config.h"
 #include "gui.h"
 #include "hmd.h"
+#include "log.h"
+
+#if ENABLE_HEADLESS
+#include <GL/osmesa.h>
+#endif
 
 extern const char TITLE[];
 extern const char ICON[];
@@ -118,6 +123,30 @@ int video_display(void)
         return -1;
 }
 
+static void video_init_gl(void)
+{
+    glViewport(0, 0, video.device_w, video.device_h);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+    glEnable(GL_NORMALIZE);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_BLEND);
+
+#if !ENABLE_OPENGLES
+    glLightModeli(GL_LIGHT_MODEL_COLOR_CONTROL,
+                  GL_SEPARATE_SPECULAR_COLOR);
+#endif
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthFunc(GL_LEQUAL);
+}
+
 int video_init(void)
 {
     if (!video_mode(config_get_d(CONFIG_FULLSCREEN),
@@ -258,26 +287,7 @@ int video_mode(int f, int w, int h)
         if (!glext_init())
             return 0;
 
-        glViewport(0, 0, video.device_w, video.device_h);
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-
-        glEnable(GL_NORMALIZE);
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_LIGHTING);
-        glEnable(GL_BLEND);
-
-#if !ENABLE_OPENGLES
-        glLightModeli(GL_LIGHT_MODEL_COLOR_CONTROL,
-                      GL_SEPARATE_SPECULAR_COLOR);
-#endif
-
-        glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDepthFunc(GL_LEQUAL);
+        video_init_gl();
 
         /* If GL supports multisample, and SDL got a multisample buffer... */
 
@@ -337,6 +347,70 @@ int video_mode(int f, int w, int h)
 
 /*---------------------------------------------------------------------------*/
 
+#if ENABLE_HEADLESS
+
+/*
+ * Offscreen rendering into client memory through OSMesa, which needs
+ * neither a display nor a GPU.
+ */
+
+static OSMesaContext  headless;
+static GLubyte       *headless_buf;
+
+int video_init_headless(int w, int h)
+{
+    int stencil = config_get_d(CONFIG_REFLECTION) ? 8 : 0;
+
+    log_printf("Creating an offscreen context (%dx%d)\n", w, h);
+
+    if (!(headless = OSMesaCreateContextExt(OSMESA_RGBA, 16, stencil, 0, NULL)))
+    {
+        log_printf("Failure to create offscreen context\n");
+        return 0;
+    }
+
+    if (!(headless_buf = (GLubyte *) malloc(w * h * 4)) ||
+        !OSMesaMakeCurrent(headless, headless_buf, GL_UNSIGNED_BYTE, w, h))
+    {
+        log_printf("Failure to bind offscreen buffer\n");
+        video_quit_headless();
+        return 0;
+    }
+
+    video.window_w = video.device_w = w;
+    video.window_h = video.device_h = h;
+
+    video.device_scale = 1.0f;
+
+    if (!glext_init())
+    {
+        video_quit_headless();
+        return 0;
+    }
+
+    video_init_gl();
+
+    snapshot_init();
+
+    return 1;
+}
+
+void video_quit_headless(void)
+{
+    if (headless)
+    {
+        OSMesaDestroyContext(headless);
+        headless = NULL;
+    }
+
+    free(headless_buf);
+    headless_buf = NULL;
+}
+
+#endif
+
+/*---------------------------------------------------------------------------*/
+
 static float ms     = 0;
 static int   fps    = 0;
 static int   last   = 0;
@@ -359,7 +433,10 @@ void video_swap(void)
 
     snapshot_take();
 
-    SDL_GL_SwapWindow(window);
+    if (window)
+        SDL_GL_SwapWindow(window);
+    else
+        glFinish();
 
     /* Accumulate time passed and frames rendered. */
 
@@ -369,6 +446,10 @@ void video_swap(void)
     ticks  += dt;
     last   += dt;
 
+#if ENABLE_GLSTAT
+    glstat_frame(dt);
+#endif
+
     /* Average over 250ms. */
 
     if (ticks > 1000)
@@ -29,6 +29,11 @@ extern struct video video;
 
 int video_init(void);
 
+#if ENABLE_HEADLESS
+int  video_init_headless(int, int);
+void video_quit_headless(void);
+#endif
+
 /*---------------------------------------------------------------------------*/
 
 int  video_mode(int, int, int);